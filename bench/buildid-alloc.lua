@@ -0,0 +1,137 @@
+--- Microbenchmark of the buildid walk. Calculates the buildids of all results
+-- of a project like e2-build --buildid and reports the time taken, the memory
+-- allocated and the number of error objects created on the way. The garbage
+-- collector is stopped during the walk, the growth of the Lua heap is the
+-- amount allocated.
+--
+-- Run in a project with the local tools, e.g.
+--   e2-lua buildid-alloc.lua [--no-call-trace] [--tag|--branch|--wc-mode ...]
+-- with LUA_PATH and LUA_CPATH pointing to .e2/lib/e2, as run-bench.sh does.
+
+-- Copyright (C) 2007-2016 emlix GmbH, see file AUTHORS
+--
+-- This file is part of e2factory, the emlix embedded build system.
+-- For more information see http://www.e2factory.org
+--
+-- e2factory is a registered trademark of emlix GmbH.
+--
+-- e2factory is free software: you can redistribute it and/or modify it under
+-- the terms of the GNU General Public License as published by the
+-- Free Software Foundation, either version 3 of the License, or (at your
+-- option) any later version.
+--
+-- This program is distributed in the hope that it will be useful, but WITHOUT
+-- ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+-- FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+-- more details.
+
+local console = require("console")
+local e2build = require("e2build")
+local e2lib = require("e2lib")
+local e2option = require("e2option")
+local e2tool = require("e2tool")
+local err = require("err")
+local policy = require("policy")
+local result = require("result")
+local trace = require("trace")
+
+local function buildid_alloc(arg)
+    local rc, re, e2project, opts, build_mode, ordered, set, resultnames
+    local errors, fileids, kb0, kb1, t0, t1, new, fileid
+
+    rc, re = e2lib.init()
+    if not rc then
+        error(re)
+    end
+
+    e2project = e2tool.e2project()
+    e2project:init_project("buildid-alloc")
+
+    policy.register_commandline_options()
+    e2option.flag("no-call-trace",
+        "measure without the function call tracer of the debug log")
+    opts, re = e2option.parse(arg)
+    if not opts then
+        error(re)
+    end
+
+    if opts["no-call-trace"] then
+        trace.uninstall()
+    end
+
+    build_mode, re = policy.handle_commandline_options(opts, true)
+    if not build_mode then
+        error(re)
+    end
+
+    rc, re = e2project:load_project()
+    if not rc then
+        error(re)
+    end
+
+    resultnames = {}
+    for resultname,_ in pairs(result.results) do
+        table.insert(resultnames, resultname)
+    end
+    table.sort(resultnames)
+
+    ordered, re = e2tool.dlist_recursive(resultnames)
+    if not ordered then
+        error(re)
+    end
+
+    set = e2build.build_set:new()
+    for _,resultname in ipairs(ordered) do
+        set:add(resultname, "build", build_mode)
+    end
+
+    -- count error objects and fileids calculated during the walk
+    errors = 0
+    new = err.new
+    err.new = function(...)
+        errors = errors + 1
+        return new(...)
+    end
+    fileids = 0
+    fileid = e2tool.file_class.fileid
+    e2tool.file_class.fileid = function(...)
+        fileids = fileids + 1
+        return fileid(...)
+    end
+
+    collectgarbage("collect")
+    collectgarbage("stop")
+    kb0 = collectgarbage("count")
+    t0 = e2lib.monotime()
+
+    for _,resultname in ipairs(ordered) do
+        local bid
+        bid, re = result.results[resultname]:buildid(
+            set:result_build_set(resultname))
+        if not bid then
+            error(re)
+        end
+    end
+
+    t1 = e2lib.monotime()
+    kb1 = collectgarbage("count")
+    collectgarbage("restart")
+
+    err.new = new
+    e2tool.file_class.fileid = fileid
+
+    console.infof("results     %d\n", #ordered)
+    console.infof("fileids     %d\n", fileids)
+    console.infof("errors      %d\n", errors)
+    console.infof("allocated   %.1f KiB\n", kb1 - kb0)
+    console.infof("time        %.3f s\n", t1 - t0)
+end
+
+local pc, re = e2lib.trycall(buildid_alloc, arg)
+if not pc then
+    e2lib.abort(re)
+end
+
+e2lib.finish(0)
+
+-- vim:sw=4:sts=4:et:
@@ -0,0 +1,179 @@
+#!/bin/sh
+#
+# Copyright (C) 2007-2016 emlix GmbH, see file AUTHORS
+#
+# This file is part of e2factory, the emlix embedded build system.
+# For more information see http://www.e2factory.org
+#
+# e2factory is a registered trademark of emlix GmbH.
+#
+# e2factory is free software: you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+# more details.
+
+# Benchmark of e2factory on a synthetic project.
+#
+# Generates a project with synth-project.lua, creates it on local file://
+# servers and times the e2 tools on it. The local tools of the project are
+# built from HEAD of the e2factory git repository this script is part of,
+# the global tools are taken from PATH. The timings are written as JSON,
+# for comparison between versions. The allocations of the buildid walk are
+# logged by buildid-alloc.lua, see bench.log.
+#
+# Usage: run-bench.sh [-n RUNS] [-o REPORT] [-b] WORKDIR [--key=value ...]
+#
+#   -n RUNS    runs of each timed command, the minimum is reported (3)
+#   -o REPORT  JSON report file (WORKDIR/report.json)
+#   -b         also time full and no-op builds, requires a working e2-su
+#              and --base-chroot=FILE with a root file system
+#
+# All --key=value arguments are passed to synth-project.lua. WORKDIR must
+# not exist.
+
+set -e
+
+die() {
+    echo "run-bench.sh: $*" >&2
+    exit 1
+}
+
+RUNS=3
+REPORT=
+BUILD=0
+while getopts n:o:b opt; do
+    case $opt in
+    n) RUNS=$OPTARG ;;
+    o) REPORT=$OPTARG ;;
+    b) BUILD=1 ;;
+    *) die "usage: run-bench.sh [-n RUNS] [-o REPORT] [-b] WORKDIR [--key=value ...]" ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+test $# -ge 1 || die "WORKDIR missing"
+mkdir -p "$(dirname "$1")"
+W=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+shift
+test ! -e "$W" || die "$W exists"
+test -n "$REPORT" || REPORT=$W/report.json
+
+BENCHDIR=$(cd "$(dirname "$0")" && pwd)
+SRCDIR=$(cd "$BENCHDIR/.." && pwd)
+
+command -v e2 >/dev/null || die "e2 not found in PATH"
+PREFIX=$(e2 --prefix)
+LUA=$PREFIX/libexec/e2/e2-lua-5.1.3
+test -x "$LUA" || die "$LUA not found"
+E2TAG=$(e2 --version | head -n 1)
+
+# e2-create-project and the project commit need a git identity
+export GIT_AUTHOR_NAME=${GIT_AUTHOR_NAME:-bench}
+export GIT_AUTHOR_EMAIL=${GIT_AUTHOR_EMAIL:-bench@localhost}
+export GIT_COMMITTER_NAME=${GIT_COMMITTER_NAME:-bench}
+export GIT_COMMITTER_EMAIL=${GIT_COMMITTER_EMAIL:-bench@localhost}
+
+CONF=$W/e2.conf
+PRJ=$W/project
+LOG=$W/bench.log
+
+mkdir -p "$W"
+echo "generating project in $W"
+"$LUA" "$BENCHDIR/synth-project.lua" "$W" "$@"
+sed -i -e "s|@E2_TAG@|$E2TAG|" "$CONF"
+
+# local tools are built from HEAD, tagged with the version of the global tools
+git clone -q --bare "$SRCDIR" "$W/servers/git/e2factory.git"
+git --git-dir="$W/servers/git/e2factory.git" tag -f "$E2TAG" HEAD >/dev/null
+
+echo "creating project"
+e2-create-project --e2-config="$CONF" synth >>"$LOG" 2>&1 ||
+    die "e2-create-project failed, see $LOG"
+e2-fetch-project --e2-config="$CONF" synth "$PRJ" >>"$LOG" 2>&1 ||
+    die "e2-fetch-project failed, see $LOG"
+cp -r "$W/tree/." "$PRJ/"
+(
+    cd "$PRJ"
+    git add proj res src
+    git commit -q -m "synthetic project"
+)
+
+RESULTS=
+LEAF=$(cd "$PRJ/res" && ls | head -n 1)
+TOP=$(cd "$PRJ/res" && ls | tail -n 1)
+
+now() {
+    date +%s.%N
+}
+
+# Time a command run in the project, RUNS times unless --once is given.
+# Usage: bench [--once] [--before CMD] NAME COMMAND...
+bench() {
+    local runs before name t0 t1 rc times min status
+    runs=$RUNS
+    before=:
+    while true; do
+        case $1 in
+        --once) runs=1; shift ;;
+        --before) before=$2; shift 2 ;;
+        *) break ;;
+        esac
+    done
+    name=$1
+    shift
+
+    times=
+    status=0
+    i=0
+    while [ $i -lt "$runs" ]; do
+        (cd "$PRJ" && eval "$before")
+        echo "== $name: $*" >>"$LOG"
+        t0=$(now)
+        rc=0
+        (cd "$PRJ" && "$@" --e2-config="$CONF") >>"$LOG" 2>&1 || rc=$?
+        t1=$(now)
+        test $rc -eq 0 || status=$rc
+        times="$times${times:+, }$(echo "$t0 $t1" | awk '{ printf "%.3f", $2 - $1 }')"
+        i=$((i + 1))
+    done
+
+    min=$(echo "$times" | tr -d ' ' | tr ',' '\n' | sort -n | head -n 1)
+    printf '%-24s %8ss  (exit status %d)\n' "$name" "$min" "$status"
+    RESULTS="$RESULTS${RESULTS:+,
+}    \"$name\": { \"min\": $min, \"runs\": [ $times ], \"status\": $status }"
+}
+
+echo "running benchmarks"
+bench --before "rm -f .e2/configcache" ls-project-cold e2-ls-project --all
+bench ls-project e2-ls-project --all
+bench dlist e2-dlist --recursive "$TOP"
+bench buildid e2-build --buildid
+bench buildid-one e2-build --buildid "$LEAF"
+LIB=$PRJ/.e2/lib/e2
+bench buildid-walk env LUA_PATH="$LIB/?.lc;$LIB/?.lua" LUA_CPATH="$LIB/?.so" \
+    .e2/bin/e2-lua "$BENCHDIR/buildid-alloc.lua" --no-call-trace
+bench --once fetch-sources-cold e2-fetch-sources --all
+bench fetch-sources e2-fetch-sources --all
+if [ $BUILD -eq 1 ]; then
+    bench --once build-full e2-build
+    bench build-noop e2-build
+fi
+
+cat >"$REPORT" <<EOF
+{
+  "e2version": "$E2TAG",
+  "commit": "$(git -C "$SRCDIR" rev-parse HEAD)",
+  "host": "$(uname -srm)",
+  "date": "$(date -u +%Y-%m-%dT%H:%M:%SZ)",
+  "params": $(cat "$W/params.json"),
+  "results": {
+$RESULTS
+  }
+}
+EOF
+echo "report written to $REPORT"
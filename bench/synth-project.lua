@@ -0,0 +1,433 @@
+--- Generator of synthetic e2factory projects for benchmarking.
+-- Writes servers, an e2.conf using them through file:// URLs and a tree of
+-- project files (proj/, res/, src/) to copy into a project checkout.
+-- The output only depends on the parameters, including the seed.
+--
+-- Usage: lua synth-project.lua OUTDIR [--key=value ...]
+--
+-- results=N              number of results (100)
+-- sources=N              number of sources (100)
+-- depth=N                dependency levels, results of a level depend on
+--                        results of the level below (5)
+-- fanout=N               dependencies of a result (3)
+-- sources-per-result=N   sources used by a result (2)
+-- files=N                files per source (3)
+-- file-size=BYTES        size of each source file (4096)
+-- chroot-groups=N        chroot groups besides "base" (2)
+-- chroot-size=BYTES      size of the archive of each chroot group (65536)
+-- base-chroot=FILE       tar.gz with a root file system for the "base"
+--                        group. Without it a placeholder is used, and
+--                        results can not be built.
+-- seed=N                 seed of the pseudo random numbers (1)
+
+-- Copyright (C) 2007-2016 emlix GmbH, see file AUTHORS
+--
+-- This file is part of e2factory, the emlix embedded build system.
+-- For more information see http://www.e2factory.org
+--
+-- e2factory is a registered trademark of emlix GmbH.
+--
+-- e2factory is free software: you can redistribute it and/or modify it under
+-- the terms of the GNU General Public License as published by the
+-- Free Software Foundation, either version 3 of the License, or (at your
+-- option) any later version.
+--
+-- This program is distributed in the hope that it will be useful, but WITHOUT
+-- ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+-- FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+-- more details.
+
+local params = {
+    ["results"] = 100,
+    ["sources"] = 100,
+    ["depth"] = 5,
+    ["fanout"] = 3,
+    ["sources-per-result"] = 2,
+    ["files"] = 3,
+    ["file-size"] = 4096,
+    ["chroot-groups"] = 2,
+    ["chroot-size"] = 65536,
+    ["base-chroot"] = false,
+    ["seed"] = 1,
+}
+
+--- Name of the generated project.
+local PROJECT = "synth"
+
+local function die(fmt, ...)
+    io.stderr:write("synth-project: " .. string.format(fmt, ...) .. "\n")
+    os.exit(1)
+end
+
+--- Quote a string for the shell.
+local function q(s)
+    return "'" .. s:gsub("'", "'\\''") .. "'"
+end
+
+local function run(cmd)
+    if os.execute(cmd) ~= 0 then
+        die("command failed: %s", cmd)
+    end
+end
+
+local function mkdir(path)
+    run("mkdir -p " .. q(path))
+end
+
+local function write(path, data)
+    local f, msg = io.open(path, "wb")
+    if not f then
+        die("%s", msg)
+    end
+    f:write(data)
+    f:close()
+end
+
+--- Pseudo random numbers independent of the C library (Park-Miller).
+local rnd_state
+
+local function rnd_seed(seed)
+    rnd_state = seed % 2147483647
+    if rnd_state <= 0 then
+        rnd_state = rnd_state + 2147483646
+    end
+end
+
+--- Random integer in [1, n].
+local function rnd(n)
+    rnd_state = (rnd_state * 16807) % 2147483647
+    return rnd_state % n + 1
+end
+
+--- Random bytes, repeated in blocks of 64 KiB. Blocks larger than the
+-- deflate window keep the data incompressible.
+local block = false
+
+local function rnd_bytes(size)
+    local out, b
+
+    if not block then
+        b = {}
+        for i = 1, 65536 do
+            b[i] = string.char(rnd(256) - 1)
+        end
+        block = table.concat(b)
+    end
+
+    out = {}
+    while size > 0 do
+        local n = math.min(size, #block)
+        local off = rnd(#block - n + 1)
+        table.insert(out, block:sub(off, off + n - 1))
+        size = size - n
+    end
+
+    return table.concat(out)
+end
+
+--- SHA1 checksums of files, computed in one sha1sum call.
+-- @param dir Directory of the files.
+-- @param names Vector of file names.
+-- @return Table of checksums indexed by file name.
+local function sha1sums(dir, names)
+    local cmd, f, sums
+
+    cmd = "cd " .. q(dir) .. " && sha1sum"
+    for _,name in ipairs(names) do
+        cmd = cmd .. " " .. q(name)
+    end
+
+    f = io.popen(cmd)
+    sums = {}
+    for line in f:lines() do
+        local sum, name = line:match("^(%x+)  (.+)$")
+        if sum then
+            sums[name] = sum
+        end
+    end
+    f:close()
+
+    for _,name in ipairs(names) do
+        if not sums[name] then
+            die("no checksum of %s/%s", dir, name)
+        end
+    end
+
+    return sums
+end
+
+local function luastring(s)
+    return string.format("%q", s)
+end
+
+local function lualist(v)
+    local out = {}
+    for _,s in ipairs(v) do
+        table.insert(out, luastring(s))
+    end
+    return "{ " .. table.concat(out, ", ") .. " }"
+end
+
+--- Create the servers and e2.conf.
+local function gen_servers(outdir)
+    local conf = {}
+
+    for _,s in ipairs({ "upstream", "chroot", "projects", "results",
+        "releases", "git" }) do
+        mkdir(outdir .. "/servers/" .. s)
+    end
+    mkdir(outdir .. "/cache")
+
+    table.insert(conf, "config {\n")
+    table.insert(conf, "\tsite = {\n")
+    table.insert(conf, "\t\te2_server = \"git\",\n")
+    table.insert(conf, "\t\te2_location = \"e2factory.git\",\n")
+    table.insert(conf, "\t\te2_base = \".\",\n")
+    table.insert(conf, "\t\te2_branch = \"master\",\n")
+    table.insert(conf, "\t\te2_tag = \"@E2_TAG@\",\n")
+    table.insert(conf, "\t\tdefault_extensions = {},\n")
+    table.insert(conf, "\t},\n")
+    table.insert(conf, "\ttools = {},\n")
+    table.insert(conf, string.format("\tcache = { path = %s },\n",
+        luastring(outdir .. "/cache")))
+    table.insert(conf, "\tservers = {\n")
+    for _,s in ipairs({ "upstream", "chroot", "projects", "results",
+        "releases", "git" }) do
+        table.insert(conf, string.format(
+            "\t\t%s = { url = %s, cachable = true, cache = true, " ..
+            "writeback = true },\n", s,
+            luastring("file://" .. outdir .. "/servers/" .. s)))
+    end
+    table.insert(conf, "\t},\n}\n")
+
+    write(outdir .. "/e2.conf", table.concat(conf))
+end
+
+--- Create the chroot group archives and proj/chroot.
+-- @return Vector of chroot group names besides "base".
+local function gen_chroot(outdir, tree)
+    local dir, groups, names, sums, out
+
+    dir = outdir .. "/servers/chroot/" .. PROJECT
+    mkdir(dir)
+
+    if params["base-chroot"] then
+        run("cp " .. q(params["base-chroot"]) .. " " .. q(dir .. "/base.tar.gz"))
+    else
+        local tmp = outdir .. "/tmp/base"
+        mkdir(tmp .. "/etc")
+        write(tmp .. "/etc/synth-placeholder", "no root file system\n")
+        run("tar -C " .. q(tmp) .. " -czf " .. q(dir .. "/base.tar.gz") .. " .")
+    end
+
+    groups = {}
+    names = { "base.tar.gz" }
+    for g = 1, params["chroot-groups"] do
+        local name = string.format("group%d", g)
+        local tmp = outdir .. "/tmp/" .. name
+        mkdir(tmp .. "/opt/" .. name)
+        write(tmp .. "/opt/" .. name .. "/data",
+            rnd_bytes(params["chroot-size"]))
+        run("tar -C " .. q(tmp) .. " -czf " .. q(dir .. "/" .. name ..
+            ".tar.gz") .. " .")
+        table.insert(groups, name)
+        table.insert(names, name .. ".tar.gz")
+    end
+    sums = sha1sums(dir, names)
+
+    out = { "e2chroot {\n\tdefault_groups = { \"base\" },\n\tgroups = {\n" }
+    for _,name in ipairs({ "base", unpack(groups) }) do
+        table.insert(out, string.format("\t\t{\n\t\t\tname = %s,\n" ..
+            "\t\t\tserver = \"chroot\",\n\t\t\tfiles = {\n\t\t\t\t{ " ..
+            "location = %s, sha1 = %s },\n\t\t\t},\n\t\t},\n",
+            luastring(name), luastring(PROJECT .. "/" .. name .. ".tar.gz"),
+            luastring(sums[name .. ".tar.gz"])))
+    end
+    table.insert(out, "\t},\n}\n")
+    write(tree .. "/proj/chroot", table.concat(out))
+
+    return groups
+end
+
+--- Create the source files and src/*/config.
+-- @return Vector of source names.
+local function gen_sources(outdir, tree)
+    local sources = {}
+
+    for s = 1, params["sources"] do
+        local name, dir, names, sums, out
+
+        name = string.format("s%05d", s)
+        dir = outdir .. "/servers/upstream/" .. PROJECT .. "/" .. name
+        mkdir(dir)
+
+        names = {}
+        for f = 1, params["files"] do
+            local fname = string.format("f%03d", f)
+            write(dir .. "/" .. fname, rnd_bytes(params["file-size"]))
+            table.insert(names, fname)
+        end
+        sums = sha1sums(dir, names)
+
+        out = { "e2source {\n\ttype = \"files\",\n\tlicences = {},\n" ..
+            "\tserver = \"upstream\",\n\tfile = {\n" }
+        for _,fname in ipairs(names) do
+            table.insert(out, string.format(
+                "\t\t{ location = %s, sha1 = %s, copy = \".\" },\n",
+                luastring(PROJECT .. "/" .. name .. "/" .. fname),
+                luastring(sums[fname])))
+        end
+        table.insert(out, "\t},\n}\n")
+
+        mkdir(tree .. "/src/" .. name)
+        write(tree .. "/src/" .. name .. "/config", table.concat(out))
+        table.insert(sources, name)
+    end
+
+    return sources
+end
+
+--- Build script of every result: checksums and copies of all sources and
+-- dependencies, so build time and result size follow the parameters.
+local BUILD_SCRIPT = [[
+# generated by synth-project.lua
+set -e
+cd /tmp/e2
+find build dep -type f | sort | xargs -r sha1sum > out/sha1sums
+tar -cf out/build.tar build
+]]
+
+--- Create res/*/{config,build-script} and proj/config.
+local function gen_results(tree, sources, groups)
+    local levels, nlevels, top, per_level
+
+    nlevels = math.max(1, math.min(params["depth"], params["results"]))
+    per_level = math.ceil(params["results"] / nlevels)
+
+    -- results of level 1 have no dependencies
+    levels = {}
+    for r = 1, params["results"] do
+        local level = math.floor((r - 1) / per_level) + 1
+        levels[level] = levels[level] or {}
+        table.insert(levels[level], string.format("r%02d-%05d", level, r))
+    end
+
+    for level, names in ipairs(levels) do
+        for _,name in ipairs(names) do
+            local depends, srcs, chroot, seen
+
+            depends = {}
+            if level > 1 then
+                local below = levels[level - 1]
+                seen = {}
+                for _ = 1, math.min(params["fanout"], #below) do
+                    local dep
+                    repeat
+                        dep = below[rnd(#below)]
+                    until not seen[dep]
+                    seen[dep] = true
+                    table.insert(depends, dep)
+                end
+                table.sort(depends)
+            end
+
+            srcs = {}
+            seen = {}
+            for _ = 1, math.min(params["sources-per-result"], #sources) do
+                local src
+                repeat
+                    src = sources[rnd(#sources)]
+                until not seen[src]
+                seen[src] = true
+                table.insert(srcs, src)
+            end
+            table.sort(srcs)
+
+            chroot = {}
+            if #groups > 0 then
+                table.insert(chroot, groups[rnd(#groups)])
+            end
+
+            mkdir(tree .. "/res/" .. name)
+            write(tree .. "/res/" .. name .. "/config", string.format(
+                "e2result {\n\tchroot = %s,\n\tdepends = %s,\n" ..
+                "\tsources = %s,\n}\n", lualist(chroot), lualist(depends),
+                lualist(srcs)))
+            write(tree .. "/res/" .. name .. "/build-script", BUILD_SCRIPT)
+        end
+    end
+
+    top = levels[#levels]
+    write(tree .. "/proj/config", string.format(
+        "e2project {\n\tname = %s,\n\trelease_id = \"synth-1\",\n" ..
+        "\tdefault_results = %s,\n\tdeploy_results = {},\n" ..
+        "\tchroot_arch = \"x86_64\",\n}\n", luastring(PROJECT), lualist(top)))
+end
+
+local function main(args)
+    local outdir, tree, sources, groups, out, keys
+
+    for _,a in ipairs(args) do
+        local k, v = a:match("^%-%-([%w-]+)=(.*)$")
+        if k then
+            if params[k] == nil then
+                die("unknown parameter: %s", k)
+            elseif k == "base-chroot" then
+                params[k] = v
+            else
+                params[k] = tonumber(v)
+                if not params[k] or params[k] < 0
+                    or params[k] ~= math.floor(params[k]) then
+                    die("%s expects a number: %s", k, v)
+                end
+            end
+        elseif not outdir and not a:match("^%-") then
+            outdir = a
+        else
+            die("usage: synth-project.lua OUTDIR [--key=value ...]")
+        end
+    end
+
+    if not outdir then
+        die("usage: synth-project.lua OUTDIR [--key=value ...]")
+    elseif not outdir:match("^/") then
+        die("OUTDIR must be an absolute path")
+    elseif params["results"] < 1 or params["sources"] < 1 then
+        die("results and sources must be at least 1")
+    end
+
+    rnd_seed(params["seed"])
+
+    tree = outdir .. "/tree"
+    mkdir(tree .. "/proj")
+    mkdir(tree .. "/res")
+    mkdir(tree .. "/src")
+
+    gen_servers(outdir)
+    groups = gen_chroot(outdir, tree)
+    sources = gen_sources(outdir, tree)
+    gen_results(tree, sources, groups)
+    run("rm -rf " .. q(outdir .. "/tmp"))
+
+    -- parameters for the benchmark report
+    keys = {}
+    for k,_ in pairs(params) do
+        table.insert(keys, k)
+    end
+    table.sort(keys)
+    out = {}
+    for _,k in ipairs(keys) do
+        local v = params[k]
+        if type(v) == "number" then
+            table.insert(out, string.format("%q: %d", k, v))
+        else
+            table.insert(out, string.format("%q: %s", k,
+                v and luastring(v) or "null"))
+        end
+    end
+    write(outdir .. "/params.json", "{ " .. table.concat(out, ", ") .. " }\n")
+end
+
+main(arg)
+
+-- vim:sw=4:sts=4:et:
@@ -0,0 +1,23 @@
+local buildconfig = {}
+local strict = require("strict")
+buildconfig.PREFIX="/usr/local"
+buildconfig.BINDIR="/usr/local/bin"
+buildconfig.LIBDIR="/usr/local/lib/e2"
+buildconfig.TOOLDIR="/usr/local/libexec/e2/tools"
+buildconfig.SYSCONFDIR="/etc/e2"
+buildconfig.E2=""
+buildconfig.LUA="/usr/local/libexec/e2/e2-lua-5.1.3"
+buildconfig.MAKE="make"
+buildconfig.MAJOR="2"
+buildconfig.MINOR="3"
+buildconfig.PATCHLEVEL="18"
+buildconfig.EXTRAVERSION="p0"
+buildconfig.VERSION="2.3.18p0"
+buildconfig.VERSIONSTRING="e2factory-2.3.18p0"
+buildconfig.GLOBAL_INTERFACE_VERSION={
+ "2",
+}
+buildconfig.SYNTAX={
+ "2_3_6",
+}
+return strict.lock(buildconfig)
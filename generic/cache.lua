@@ -24,6 +24,7 @@ package.loaded["cache"] = cache -- stop module loading loop
 local e2lib = require("e2lib")
 local err = require("err")
 local strict = require("strict")
+local traceevent = require("traceevent")
 local transport = require("transport")
 local url = require("url")
 
@@ -68,6 +69,7 @@ local function new_cache(name, url)
     c._name = name
     c._url = url
     c._ce = {}
+    c._wbqueue = false
 
     e2lib.logf(4, "Cache: %s", c._name)
     e2lib.logf(4, " url: %s", c._url)
@@ -221,8 +223,10 @@ end
 
 local function assertFlags(flags)
     local known = {
+        barrier = "boolean",
         cachable = "boolean",
         cache = "boolean",
+        ignore_existing = "boolean",
         islocal = "boolean",
         push_permissions = "string",
         try_hardlink = "boolean",
@@ -512,6 +516,23 @@ local function file_is_local(c, server, location, flags)
     return false
 end
 
+--- Error of cache_file(), created on failure only as files are cached for
+-- every fetch.
+-- @param server Server name.
+-- @param location Location on the server.
+-- @param re Error object or message of the failing operation.
+-- @return Error object.
+local function cache_file_error(server, location, re)
+    return err.new("caching file failed: %s:%s", server, location):cat(re)
+end
+
+--- Error of cache.fetch_file_path(), created on failure only.
+-- @param re Error object of the failing operation.
+-- @return Error object.
+local function fetch_path_error(re)
+    return err.new("fetching file to provide file path failed"):cat(re)
+end
+
 --- cache a file
 -- @param c the cache data structure
 -- @param server the server to fetch the file from
@@ -520,25 +541,25 @@ end
 -- @return bool
 -- @return an error object on failure
 local function cache_file(c, server, location, flags)
-    local e = err.new("caching file failed: %s:%s", server, location)
-    local rc, re
-    local ce, re = cache.ce_by_server(c, server)
+    local rc, re, ce, ceurl, avail
+
+    ce, re = cache.ce_by_server(c, server)
     if not ce then
-        return false, e:cat(re)
+        return false, cache_file_error(server, location, re)
     end
     assertFlags(flags)
 
     if not cache.cache_enabled(c, server, flags) then
-        return false, e:append("caching is disabled")
+        return false, cache_file_error(server, location, "caching is disabled")
     end
 
-    local ceurl, re = url.parse(ce.cache_url)
+    ceurl, re = url.parse(ce.cache_url)
     if not ceurl then
-        return false, e:cat(re)
+        return false, cache_file_error(server, location, re)
     end
-    local avail, re = cache.file_in_cache(c, server, location)
+    avail, re = cache.file_in_cache(c, server, location)
     if re then
-        return false, e:cat(re)
+        return false, cache_file_error(server, location, re)
     end
     if not avail then
         local destdir = e2lib.join("/", ceurl.path, e2lib.dirname(location))
@@ -546,7 +567,7 @@ local function cache_file(c, server, location, flags)
         rc, re = transport.fetch_file(ce.remote_url, location,
             destdir, e2lib.basename(location))
         if not rc then
-            return false, e:cat(re)
+            return false, cache_file_error(server, location, re)
         end
     end
 
@@ -573,10 +594,10 @@ function cache.fetch_file(c, server, location, destdir, destname, flags)
     assertFlags(flags)
 
     local rc, re
-    local e = err.new("cache: fetching file failed")
+    local tev = traceevent.begin()
     local ce, re = cache.ce_by_server(c, server)
     if not ce then
-        return false, e:cat(re)
+        return false, err.new("cache: fetching file failed"):cat(re)
     end
 
     if cache.cache_enabled(c, server, flags) then
@@ -584,21 +605,23 @@ function cache.fetch_file(c, server, location, destdir, destname, flags)
         -- fetch from source to cache and from cache to destination
         rc, re = cache_file(c, server, location, flags)
         if not rc then
-            return false, e:cat(re)
+            return false, err.new("cache: fetching file failed"):cat(re)
         end
         rc, re = transport.fetch_file(ce.cache_url, location, destdir, destname)
         if not rc then
-            return false, e:cat(re)
+            return false, err.new("cache: fetching file failed"):cat(re)
         end
     else
         -- cache is disabled:
         -- fetch from source to destination
         rc, re = transport.fetch_file(ce.remote_url, location, destdir, destname)
         if not rc then
-            return false, e:cat(re)
+            return false, err.new("cache: fetching file failed"):cat(re)
         end
     end
 
+    traceevent.complete(tev, e2lib.basename(location), "fetch",
+        { server = server, location = location })
     return true
 end
 
@@ -620,25 +643,24 @@ function cache.fetch_file_path(c, server, location, flags)
     flags = flags or {}
     assertFlags(flags)
 
-    local rc, re, e
+    local rc, re
     local ce, filepath
 
-    e = err.new("fetching file to provide file path failed")
     ce, re = cache.ce_by_server(c, server)
     if not ce then
-        return false, e:cat(re)
+        return false, fetch_path_error(re)
     end
 
     -- If you enabled the cache, you probably prefer files from there
     if cache.cache_enabled(c, server, flags) then
         rc, re = cache_file(c, server, location, flags)
         if not rc then
-            return false, e:cat(re)
+            return false, fetch_path_error(re)
         end
 
         rc, re, filepath = cache.file_in_cache(c, server, location, flags)
         if not rc and re then
-            return false, e:cat(re)
+            return false, fetch_path_error(re)
         end
 
         assertTrue(rc)
@@ -650,7 +672,7 @@ function cache.fetch_file_path(c, server, location, flags)
     -- Second choice, the local filesystem
     rc, re, filepath = file_is_local(c, server, location, flags)
     if not rc and re then
-        return false, e:cat(re)
+        return false, fetch_path_error(re)
     elseif rc then
         assertIsNil(re)
         assertIsStringN(filepath)
@@ -660,7 +682,7 @@ function cache.fetch_file_path(c, server, location, flags)
     -- OK, we're getting a copy for you.
     filepath, re = e2lib.mktempdir()
     if not filepath then
-        return false, e:cat(re)
+        return false, fetch_path_error(re)
     end
     -- preserve the original name for file suffix info etc.
     filepath = e2lib.join(filepath, e2lib.basename(location))
@@ -668,7 +690,7 @@ function cache.fetch_file_path(c, server, location, flags)
     rc, re = cache.fetch_file(c, server, location, e2lib.dirname(filepath),
         e2lib.basename(filepath), flags)
     if not rc then
-        return false, e:cat(re)
+        return false, fetch_path_error(re)
     end
 
     return filepath, nil, true
@@ -725,7 +747,7 @@ end
 -- @param flags
 -- @return bool
 -- @return an error object on failure
-local function cache_writeback(c, server, location, flags)
+local function cache_writeback(c, server, location, flags, nowait)
     local rc, re
     assertFlags(flags)
 
@@ -744,6 +766,11 @@ local function cache_writeback(c, server, location, flags)
     end
 
     local sourcefile = string.format("/%s/%s", ceurl.path, location)
+    if c._wbqueue and not nowait then
+        return c._wbqueue(server, location, sourcefile,
+            flags.try_hardlink or false, flags.barrier or false)
+    end
+
     rc, re = transport.push_file(sourcefile, ce.remote_url, location,
         ce.flags.push_permissions, flags.try_hardlink)
     if not rc then
@@ -754,12 +781,53 @@ end
 
 local _pp_warn = true
 
+--- Write back a cached file to its server immediately, bypassing the
+-- writeback queue.
+-- @param c Cache object.
+-- @param server Server name.
+-- @param location Location of the file in the cache and on the server.
+-- @param flags Cache flags. Optional.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function cache.writeback_file(c, server, location, flags)
+    flags = flags or {}
+    assertFlags(flags)
+
+    local rc, re = cache_writeback(c, server, location, flags, true)
+    if not rc then
+        return false, err.new("error writing back %s:%s", server, location):cat(re)
+    end
+    return true
+end
+
+--- Writeback queue callback signature.
+-- @function writeback_queue_cb
+-- @param server Server name.
+-- @param location Location of the file in the cache and on the server.
+-- @param sourcefile Path to the file in the cache.
+-- @param try_hardlink Hardlink instead of copying if possible.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+
+--- Queue writebacks of cached files instead of pushing them to the server
+-- immediately. Files that are not cached are still pushed immediately.
+-- @param c Cache object.
+-- @param queuefunc writeback_queue_cb function, or false to disable queueing.
+-- @see writeback_queue_cb
+function cache.set_writeback_queue(c, queuefunc)
+    assertIsTable(c)
+    assert(queuefunc == false or type(queuefunc) == "function")
+    c._wbqueue = queuefunc
+end
+
 --- push a file to a server: cache and writeback
 -- @param c a cache table
 -- @param sourcefile where to store the file locally
 -- @param server the server name
 -- @param location location relative to the server url
--- @param flags table of flags
+-- @param flags table of flags. With the writeback queue, flags.barrier
+--              writes the file back only after all writebacks queued
+--              before it succeeded, for files marking a complete upload.
 -- @return bool
 -- @return an error object on failure
 function cache.push_file(c, sourcefile, server, location, flags)
@@ -767,6 +835,7 @@ function cache.push_file(c, sourcefile, server, location, flags)
     assertFlags(flags)
 
     local rc, re
+    local tev = traceevent.begin()
     local e = err.new("error pushing file to %s:%s", server, location)
     local ce, re = cache.ce_by_server(c, server)
     if not ce then
@@ -804,6 +873,65 @@ function cache.push_file(c, sourcefile, server, location, flags)
             return false, e:cat(re)
         end
     end
+
+    traceevent.complete(tev, e2lib.basename(location), "push",
+        { server = server, location = location })
+    return true
+end
+
+--- Push the contents of a directory to a server in a single transfer per
+-- hop: cache and writeback. The writeback is done immediately, bypassing the
+-- writeback queue, and transfers sourcedir rather than the cached directory,
+-- which may hold more files.
+-- @param c Cache object.
+-- @param sourcedir Local directory.
+-- @param server Server name.
+-- @param location Destination directory relative to the server url.
+-- @param flags Cache flags. Optional. flags.ignore_existing skips files
+--              already present on each hop, without checking their content.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function cache.push_directory(c, sourcedir, server, location, flags)
+    assertIsTable(c)
+    assertIsStringN(sourcedir)
+    assertIsStringN(server)
+    assertIsStringN(location)
+    flags = flags or {}
+    assertFlags(flags)
+
+    local rc, re, ce
+    local e = err.new("error pushing directory to %s:%s", server, location)
+
+    ce, re = cache.ce_by_server(c, server)
+    if not ce then
+        return false, e:cat(re)
+    end
+
+    if not cache.cache_enabled(c, server, flags) then
+        rc, re = transport.push_directory(sourcedir, ce.remote_url, location,
+            ce.flags.push_permissions, flags.ignore_existing)
+        if not rc then
+            return false, e:cat(re)
+        end
+        return true
+    end
+
+    rc, re = transport.push_directory(sourcedir, ce.cache_url, location,
+        nil, flags.ignore_existing)
+    if not rc then
+        return false, e:cat(re)
+    end
+
+    if cache.writeback_enabled(c, server, flags) == false then
+        return true
+    end
+
+    rc, re = transport.push_directory(sourcedir, ce.remote_url, location,
+        ce.flags.push_permissions, flags.ignore_existing)
+    if not rc then
+        return false, e:cat(re)
+    end
+
     return true
 end
 
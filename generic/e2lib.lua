@@ -49,6 +49,7 @@ local lock = require("lock")
 local plugin = require("plugin")
 local tools = require("tools")
 local trace = require("trace")
+local traceevent = require("traceevent")
 
 --- Various global settings
 -- @table globals
@@ -82,6 +83,9 @@ e2lib.globals = strict.lock({
     e2version_file = ".e2/e2version",
     syntax_file = ".e2/syntax",
     logrotate = 5,   -- configurable via config.log.logrotate
+    archive_threads = 0, -- configurable via config.site.archive_threads
+    build_jobs = 0, -- configurable via config.site.build_jobs
+    git_mirror = false, -- configurable via config.site.git_mirror
     _version = "e2factory, the emlix embedded build system, version " ..
     buildconfig.VERSION,
     _licence = [[
@@ -181,6 +185,18 @@ function e2lib.lstat(path)
     return dirent
 end
 
+--- Get file status information of many files in one call.
+-- @param paths Vector of paths.
+-- @param follow If true, follow symbolic links like e2lib.stat(), otherwise
+--               like e2lib.lstat().
+-- @return Vector of dirent tables (see @{dirent}), in the order of paths.
+--         False for every file that could not be stat'ed.
+function e2lib.statv(paths, follow)
+    assertIsTable(paths)
+
+    return le2lib.statv(paths, follow)
+end
+
 --- Checks if file exists.
 -- If executable is true, it also checks whether the file is executable.
 -- @param path Path to check.
@@ -190,6 +206,47 @@ function e2lib.exists(path, executable)
     return le2lib.exists(path, executable)
 end
 
+--- Read the target of a symlink.
+-- @param path Path to the symlink (string).
+-- @return Symlink target (string), or false on error.
+-- @return Error object on failure.
+function e2lib.readlink(path)
+    local target, errstring = le2lib.readlink(path)
+
+    if not target then
+        return false, err.new("reading symlink %q failed: %s", path, errstring)
+    end
+
+    return target
+end
+
+--- Resource usage of all terminated and waited for child processes.
+-- @return Table with the fields utime and stime (seconds), maxrss (KiB,
+--         largest child only), inblock and oublock (blocks of 512 bytes),
+--         or false on error.
+-- @return Error object on failure.
+function e2lib.getrusage_children()
+    local ru, errstring = le2lib.getrusage_children()
+
+    if not ru then
+        return false, err.new("getrusage failed: %s", errstring)
+    end
+
+    return ru
+end
+
+--- Monotonic clock with sub-second resolution, for measuring durations.
+-- @return Seconds since an arbitrary point in time (number).
+function e2lib.monotime()
+    local t, errstring = le2lib.monotime()
+
+    if not t then
+        e2lib.abort(err.new("clock_gettime failed: %s", errstring))
+    end
+
+    return t
+end
+
 --- Create a symlink.
 -- @param oldpath Path to point to (string).
 -- @param newpath New symlink path (string).
@@ -1053,6 +1110,10 @@ function e2lib.tartype_by_suffix(filename)
         tartype = "tar.gz"
     elseif filename:match("tar.bz2$") then
         tartype = "tar.bz2"
+    elseif filename:match("tzst$") or filename:match("tar.zst$") then
+        tartype = "tar.zst"
+    elseif filename:match("txz$") or filename:match("tar.xz$") then
+        tartype = "tar.xz"
     elseif filename:match("tar$") then
         tartype = "tar"
     else
@@ -1061,6 +1122,43 @@ function e2lib.tartype_by_suffix(filename)
     return tartype
 end
 
+--- Get the tar arguments selecting the (de)compression program for tartype.
+-- zstd and xz are run with config.site.archive_threads threads.
+-- @param tartype Tar type, for example "tar", "tar.gz" or "tar.zst".
+-- @return Vector of tar arguments, may be empty. False on error.
+-- @return Error object on failure.
+function e2lib.tar_compress_flags(tartype)
+    local argv, re, prog, tool
+
+    if tartype == "tar" then
+        return {}
+    elseif tartype == "tar.gz" then
+        return { "--gzip" }
+    elseif tartype == "tar.bz2" then
+        return { "--bzip2" }
+    elseif tartype == "tar.zst" then
+        tool = "zstd"
+    elseif tartype == "tar.xz" then
+        tool = "xz"
+    else
+        return false, err.new("unknown tar type: %s", tostring(tartype))
+    end
+
+    argv, re = tools.get_tool_flags_argv(tool)
+    if not argv then
+        return false, re
+    end
+    table.insert(argv, string.format("-T%d", e2lib.globals.archive_threads))
+
+    -- tar passes the program string to the shell, quote each argument
+    prog = {}
+    for _,arg in ipairs(argv) do
+        table.insert(prog, e2lib.shquote(arg))
+    end
+
+    return { "--use-compress-program=" .. table.concat(prog, " ") }
+end
+
 --- Check the global configuration for existance of fields and their types.
 -- @param config e2config table to check.
 -- @return True on success, false on error.
@@ -1144,9 +1242,48 @@ local function verify_global_config(config)
             { u = e2lib.globals.osenv["USER"] })
     end
 
+    if config.site.archive_threads ~= nil then
+        rc, re = assert_type(config.site.archive_threads,
+            "config.site.archive_threads", "number")
+        if not rc then
+            return false, re
+        end
+        if config.site.archive_threads < 0 or
+            config.site.archive_threads ~= math.floor(config.site.archive_threads) then
+            return false, err.new("configuration error: " ..
+                "config.site.archive_threads is not a positive integer or 0")
+        end
+        e2lib.globals.archive_threads = config.site.archive_threads
+    end
+
+    if config.site.build_jobs ~= nil then
+        rc, re = assert_type(config.site.build_jobs,
+            "config.site.build_jobs", "number")
+        if not rc then
+            return false, re
+        end
+        if config.site.build_jobs < 0 or
+            config.site.build_jobs ~= math.floor(config.site.build_jobs) then
+            return false, err.new("configuration error: " ..
+                "config.site.build_jobs is not a positive integer or 0")
+        end
+        e2lib.globals.build_jobs = config.site.build_jobs
+    end
+
+    if config.site.git_mirror ~= nil then
+        rc, re = assert_type(config.site.git_mirror, "config.site.git_mirror",
+            "string")
+        if not rc then
+            return false, re
+        end
+        e2lib.globals.git_mirror = e2lib.format_replace(
+            config.site.git_mirror, { u = e2lib.globals.osenv["USER"] })
+    end
+
     rc, re = e2lib.vrfy_dict_exp_keys(config.site, "e2 config.site",
         { "e2_branch", "e2_tag", "e2_server", "e2_base", "e2_location",
-          "default_extensions", "tmpdir" })
+          "default_extensions", "tmpdir", "archive_threads", "build_jobs",
+          "git_mirror" })
     if not rc then
         return false, re
     end
@@ -1161,11 +1298,24 @@ local function verify_global_config(config)
         return false, re
     end
 
-    rc, re = e2lib.vrfy_dict_exp_keys(config.cache, "e2 config.cache", { "path", })
+    rc, re = e2lib.vrfy_dict_exp_keys(config.cache, "e2 config.cache",
+        { "path", "writeback_jobs", })
     if not rc then
         return false, re
     end
 
+    if config.cache.writeback_jobs ~= nil then
+        rc, re = assert_type(config.cache.writeback_jobs,
+            "config.cache.writeback_jobs", "number")
+        if not rc then
+            return false, re
+        end
+        if config.cache.writeback_jobs < 0 then
+            return false, err.new("configuration error: " ..
+                "config.cache.writeback_jobs is negative")
+        end
+    end
+
     rc, re = e2lib.vrfy_dict_exp_keys(config, "e2 config",
         { "cache", "log", "servers", "site", "tools", })
     if not rc then
@@ -1450,6 +1600,84 @@ function e2lib.directory(path, dotfiles, noerror)
     end
 end
 
+--- Successively returns the entries in the directory together with their
+-- type, as reported by the directory itself. Unlike e2lib.directory(), the
+-- directory is read as it is iterated and telling directories from files
+-- does not take a stat per entry.
+-- @param path Directory path (string).
+-- @param dotfiles If true, also return files starting with a '.'. Optional.
+-- @param sorted If true, return the entries in sorted order. The whole
+--               directory is read first. Optional.
+-- @return Iterator function, returning the file name and type (see
+--         @{dirent}) of an entry, or false and an err object on error. The
+--         iterator signals the end of the directory by returning nil.
+function e2lib.readdir(path, dotfiles, sorted)
+    local dir, errstring, names, types, i
+
+    -- signals an error once, then the end of the directory
+    local function readerror()
+        local e
+
+        if not errstring then
+            return nil
+        end
+
+        e = err.new("reading directory `%s' failed: %s", path, errstring)
+        errstring = false
+        return false, e
+    end
+
+    dir, errstring = le2lib.opendir(path)
+    if not dir then
+        return readerror
+    end
+
+    if not sorted then
+        return function ()
+            local name, t
+
+            if not dir then
+                return readerror()
+            end
+
+            name, t = le2lib.readdir(dir, dotfiles)
+            if name == false then
+                dir = false
+                errstring = t
+                return readerror()
+            end
+
+            return name, t
+        end
+    end
+
+    names = {}
+    types = {}
+    while true do
+        local name, t = le2lib.readdir(dir, dotfiles)
+        if name == false then
+            errstring = t
+            return readerror
+        elseif name == nil then
+            break
+        end
+
+        table.insert(names, name)
+        types[name] = t
+    end
+
+    table.sort(names)
+    i = 0
+
+    return function ()
+        i = i + 1
+        if names[i] then
+            return names[i], types[names[i]]
+        end
+        return nil
+    end
+end
+
 --- If an error occurs and we have a valid PID, retrieve the exit status of the
 -- child and append it to error message, then attempt to kill(INT) the child.
 -- This function may hang until the child exits.
@@ -1984,6 +2212,7 @@ function e2lib.callcmd(argv, fdctv, workdir, envdict, nowait, pty)
         or nowait == true or nowait == 'nopoll')
 
     e2lib.logf(4, 'e2lib.callcmd argv="%s"', table.concat(argv, '", "'))
+    local tev = traceevent.begin()
 
     -- fork dance, enter critical section, block all signals
     le2lib.signal_block()
@@ -2022,6 +2251,9 @@ function e2lib.callcmd(argv, fdctv, workdir, envdict, nowait, pty)
     e2lib.logf(4, "command %q pid %d exit %d signal %d",
         table.concat(argv, " "), re, rc, sig or 0)
 
+    traceevent.complete(tev, e2lib.basename(argv[1]), "exec",
+        { argv = table.concat(argv, " "), status = rc })
+
     assert(type(rc) == "number")
     return rc
 end
@@ -2479,13 +2711,47 @@ function e2lib.unlink(pathname)
     return true
 end
 
+--- Remove the contents of a directory and the directory itself.
+-- @param pathname Directory to delete.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+local function unlink_directory(pathname)
+    local rc, re, names, types, filepath
+
+    -- read the directory before modifying it
+    names = {}
+    types = {}
+    for file, t in e2lib.readdir(pathname, true) do
+        if not file then
+            return false, t
+        end
+
+        table.insert(names, file)
+        table.insert(types, t)
+    end
+
+    for i,file in ipairs(names) do
+        filepath = e2lib.join(pathname, file)
+
+        if types[i] == "directory" then
+            rc, re = unlink_directory(filepath)
+        else
+            rc, re = e2lib.unlink(filepath)
+        end
+        if not rc then
+            return false, re
+        end
+    end
+
+    return e2lib.rmdir(pathname)
+end
+
 --- Remove directories and files recursively.
 -- @param pathname File or directory to delete.
 -- @return True on success, false on error.
 -- @return Error object on failure.
 function e2lib.unlink_recursive(pathname)
-    local de, rc, re
-    local filepath
+    local de, re
 
     de, re = e2lib.lstat(pathname) -- do not follow links
     if not de then
@@ -2493,43 +2759,10 @@ function e2lib.unlink_recursive(pathname)
     end
 
     if de.type == "directory" then
-        for file, re in e2lib.directory(pathname, true) do
-            if not file then
-                return false, re
-            end
-
-            filepath = e2lib.join(pathname, file)
-
-            de, re = e2lib.lstat(filepath) -- do not follow links
-            if not de then
-                return false, re
-            end
-
-            if de.type == "directory" then
-                rc, re = e2lib.unlink_recursive(filepath)
-                if not rc then
-                    return false, re
-                end
-            else
-                rc, re = e2lib.unlink(filepath)
-                if not rc then
-                    return false, re
-                end
-            end
-        end
-
-        rc, re = e2lib.rmdir(pathname)
-        if not rc then
-            return false, re
-        end
-    else
-        rc, re = e2lib.unlink(pathname)
-        if not rc then
-            return false, re
-        end
+        return unlink_directory(pathname)
     end
 
-    return true
+    return e2lib.unlink(pathname)
 end
 
 --- Remove single empty directory.
@@ -25,6 +25,7 @@ local buildconfig = require("buildconfig")
 local console = require("console")
 local e2lib = require("e2lib")
 local plugin = require("plugin")
+local profiler = require("profiler")
 local err = require("err")
 local strict = require("strict")
 local tools = require("tools")
@@ -228,6 +229,16 @@ local function defaultoptions()
         e2lib.finish(0)
     end,
     category)
+
+    local function profile(path)
+        local rc, re = profiler.start(path)
+        if not rc then
+            e2lib.abort(re)
+        end
+    end
+    e2option.option("profile",
+        "write a sampling profile of the Lua code to FILE", nil, profile,
+        "FILE")
 end
 
 --- Load user default options if set in $HOME/.e2/e2rc
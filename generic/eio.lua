@@ -129,6 +129,29 @@ function eio.fclose(file)
     return true
 end
 
+--- Take or release an exclusive lock on an open file, waiting until it is
+-- available. The lock is released when the file is closed, also when the
+-- process dies.
+-- @param file File object.
+-- @param lock True to take the lock, false to release it.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function eio.flock(file, lock)
+    local rc, re, errstring
+
+    rc, re = is_eio_object(file)
+    if not rc then
+        return false, re
+    end
+
+    rc, errstring = leio.flock(eio.fileno(file), lock)
+    if not rc then
+        return false, err.new("locking %s failed: %s", file.finfo, errstring)
+    end
+
+    return true
+end
+
 --- Flush file object user space buffers.
 -- @param file File object (or nil).
 -- @return True on success, false on error.
@@ -34,6 +34,39 @@ local function assert_err(e)
     return true
 end
 
+--- Deferred message: a format string and its arguments, formatted when the
+-- message is first needed. Most error objects are created on paths that
+-- succeed and are never looked at, formatting them up front is wasted.
+-- @param format Format string.
+-- @param ... Arguments of the format string.
+-- @return Message string if there is nothing to format, otherwise a
+--         deferred message table { format, n, ... }.
+local function defer(format, ...)
+    local n = select("#", ...)
+    if n == 0 and not string.find(format, "%", 1, true) then
+        return format
+    end
+    return { format, n, ... }
+end
+
+--- Format a message of an error object in place.
+-- @param e Error object.
+-- @param i Index of the message.
+-- @return Message string or sub error.
+local function resolve(e, i)
+    local m = e.msg[i]
+    if type(m) == "table" and getmetatable(m) == nil then
+        local ok, s = pcall(string.format, m[1], unpack(m, 3, m[2] + 2))
+        if not ok then
+            -- do not lose the error being reported
+            s = string.format("%s (formatting failed: %s)", m[1], s)
+        end
+        e.msg[i] = s
+        return s
+    end
+    return m
+end
+
 --- append a string to an error object
 -- @param format string: format string
 -- @param ... list of strings required for the format string
@@ -42,7 +75,7 @@ function err.append(e, format, ...)
     assert_err(e)
     assert(type(format) == "string")
     e.count = e.count + 1
-    table.insert(e.msg, string.format(format, ...))
+    table.insert(e.msg, defer(format, ...))
     return e
 end
 
@@ -57,7 +90,7 @@ function err.cat(e, re, ...)
     assert(type(re) == "string" or assert_err(re))
     -- auto-convert strings to error objects before inserting
     if type(re) == "string" then
-        if #{...} > 0 then
+        if select("#", ...) > 0 then
             re = err.new(re, ...)
         else
             re = err.new("%s", re)
@@ -83,7 +116,8 @@ function err.tostring(e, depth)
 
     local msg = ""
     local prefix = string.format("Error [%d]: ", depth)
-    for k,m in ipairs(e.msg) do
+    for k=1,#e.msg do
+        local m = resolve(e, k)
         if type(m) == "string" then
             msg = msg..string.format("%s%s\n", prefix, m)
             prefix = string.format("      [%d]: ", depth)
@@ -207,19 +241,22 @@ local err_mt = {
     __tostring = err.tostring
 }
 
---- create an error object
+--- create an error object. The message is formatted when the error object
+-- is turned into a string, creating one on a path that does not fail costs
+-- little. Still, hot functions should create their error objects on the
+-- failure paths only, as the arguments are evaluated regardless.
 -- @param format string: format string
 -- @param ... list of arguments required for the format string
 -- @return table: the error object
 function err.new(format, ...)
     assert(type(format) == "string" or format == nil)
-    local e = {}
-    e.count = 0
-    e.msg = {}
-    e.code = false
+    local e = { count = 0, code = false }
     setmetatable(e, err_mt)
     if format then
-        e:append(format, ...)
+        e.count = 1
+        e.msg = { defer(format, ...) }
+    else
+        e.msg = {}
     end
     return e
 end
@@ -36,18 +36,115 @@ local function trim(str)
     return string.match(str, "^%s*(.-)%s*$")
 end
 
+--- Mirrors fetched in this run, by path. False if fetching failed.
+local _mirrors = {}
+
+--- Get the path of the mirror of a git repository in config.site.git_mirror.
+-- @param giturl Git URL of the repository.
+-- @return Path to the mirror.
+local function mirror_path(giturl)
+    local name
+
+    -- escaped, different URLs never share a mirror
+    name = string.gsub(giturl, "[^%w.-]", function(c)
+        return string.format("%%%02X", string.byte(c))
+    end)
+
+    return e2lib.join(e2lib.globals.git_mirror, name)
+end
+
+--- Update the host wide bare mirror of a git repository, creating it on
+-- first use. Every mirror is fetched at most once per run. Mirrors only
+-- speed up cloning and fetching, failing to update one is not an error.
+-- Working copies borrow objects from the mirror, so it never drops any:
+-- refs are not pruned and gc does not remove unreachable objects.
+-- @param giturl Git URL of the repository.
+-- @return Path to the mirror, or false if mirrors are disabled or the mirror
+--         could not be updated.
+function generic_git.git_mirror(giturl)
+    assertIsStringN(giturl)
+
+    local rc, re, path, tmpdir, argv
+
+    if not e2lib.globals.git_mirror then
+        return false
+    end
+
+    path = mirror_path(giturl)
+    if _mirrors[path] ~= nil then
+        return _mirrors[path]
+    end
+    _mirrors[path] = false
+
+    if e2lib.isdir(path) then
+        e2lib.logf(2, "updating git mirror of %s", giturl)
+        argv = generic_git.git_new_argv(path, false, "fetch", "--quiet")
+        rc, re = generic_git.git(argv)
+    else
+        e2lib.logf(2, "creating git mirror of %s", giturl)
+        rc, re = e2lib.mkdir_recursive(e2lib.globals.git_mirror)
+        if rc then
+            tmpdir, re = e2lib.mktempdir(path .. ".XXXXXX")
+            rc = tmpdir and true
+        end
+        if rc then
+            argv = { "clone", "--mirror", "--quiet",
+                "--config", "gc.auto=0", "--config", "gc.pruneExpire=never",
+                giturl, e2lib.join(tmpdir, "mirror") }
+            rc, re = generic_git.git(argv)
+        end
+        if rc then
+            rc, re = e2lib.rename(e2lib.join(tmpdir, "mirror"), path)
+            -- another run may have created the mirror in the meantime
+            rc = rc or e2lib.isdir(path)
+        end
+        if tmpdir then
+            e2lib.rmtempdir(tmpdir)
+        end
+    end
+
+    if not rc then
+        e2lib.warnf("WOTHER", "not using git mirror %s: %s", path,
+            re:tostring())
+        return false
+    end
+
+    _mirrors[path] = path
+    return path
+end
+
+--- Update the mirror a working copy was cloned with, before fetching into
+-- the working copy. Does nothing if the working copy has no mirror.
+-- @param gitdir Path to GIT_DIR of the working copy.
+function generic_git.git_update_mirror(gitdir)
+    assertIsStringN(gitdir)
+
+    local giturl
+
+    if not e2lib.globals.git_mirror then
+        return
+    end
+
+    giturl = generic_git.git_config(gitdir, "remote.origin.url")
+    if giturl and giturl ~= "" and e2lib.isdir(mirror_path(giturl)) then
+        generic_git.git_mirror(giturl)
+    end
+end
+
 --- Clone a git repository.
 -- @param surl URL to the git repository (string).
 -- @param destdir Destination on file system (string). Must not exist.
 -- @param skip_checkout Pass -n to git clone? (boolean).
+-- @param shallow_branch Clone only the head commit of this branch (string),
+--                       unless a mirror is used. Optional.
 -- @return True on success, false on error.
 -- @return Error object on failure.
-local function git_clone_url(surl, destdir, skip_checkout)
+local function git_clone_url(surl, destdir, skip_checkout, shallow_branch)
     assertIsStringN(surl)
     assertIsStringN(destdir)
     assertIsBoolean(skip_checkout)
 
-    local rc, re, e, u, src, argv
+    local rc, re, e, u, src, argv, mirror
 
     e = err.new("cloning git repository")
 
@@ -67,6 +164,18 @@ local function git_clone_url(surl, destdir, skip_checkout)
         table.insert(argv, "-n")
     end
 
+    mirror = generic_git.git_mirror(src)
+    if mirror then
+        -- objects are borrowed from the mirror, see git-clone --reference
+        table.insert(argv, "--reference")
+        table.insert(argv, mirror)
+    elseif shallow_branch then
+        table.insert(argv, "--depth")
+        table.insert(argv, "1")
+        table.insert(argv, "--branch")
+        table.insert(argv, shallow_branch)
+    end
+
     table.insert(argv, "--quiet")
     table.insert(argv, src)
     table.insert(argv, destdir)
@@ -615,17 +724,19 @@ end
 -- @param location
 -- @param destdir string: destination directory
 -- @param skip_checkout bool: pass -n to git clone?
+-- @param shallow_branch string: clone only the head commit of this branch,
+--                       unless a mirror is used. Optional.
 -- @return bool
 -- @return an error object on failure
 function generic_git.git_clone_from_server(c, server, location, destdir,
-    skip_checkout)
+    skip_checkout, shallow_branch)
     local rc, re
     local e = err.new("cloning git repository")
     local surl, re = cache.remote_url(c, server, location)
     if not surl then
         return false, e:cat(re)
     end
-    local rc, re = git_clone_url(surl, destdir, skip_checkout)
+    local rc, re = git_clone_url(surl, destdir, skip_checkout, shallow_branch)
     if not rc then
         return false, re
     end
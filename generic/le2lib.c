@@ -24,6 +24,9 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <time.h>
 #include <dirent.h>
 #include <errno.h>
 #include <sys/types.h>
@@ -77,90 +80,139 @@ get_working_directory(lua_State *lua)
 	return 1;
 }
 
-static int
-get_file_statistics(lua_State *lua)
+static const char *
+file_type(mode_t mode)
 {
-	const char *p = luaL_checkstring(lua, 1);
-	static struct stat statbuf;
-	int fl = lua_gettop(lua) > 1 && lua_toboolean(lua, 2);
-	int s;
-
-	if (!fl) {
-		s = lstat(p, &statbuf);
-	} else {
-		s = stat(p, &statbuf);
-	}
-
-	if (s < 0) {
-		lua_pushboolean(lua, 0);
-		lua_pushstring(lua, strerror(errno));
-		return 2;
+	switch(mode & S_IFMT) {
+	case S_IFBLK: return "block-special";
+	case S_IFCHR: return "character-special";
+	case S_IFIFO: return "fifo-special";
+	case S_IFREG: return "regular";
+	case S_IFDIR: return "directory";
+	case S_IFLNK: return "symbolic-link";
+	case S_IFSOCK: return "socket";
+	default: return "unknown";
 	}
+}
 
-	lua_newtable(lua);
+static void
+push_stat(lua_State *lua, const struct stat *statbuf)
+{
+	lua_createtable(lua, 0, 17);
 	int t = lua_gettop(lua);
 	lua_pushstring(lua, "dev");
-	lua_pushnumber(lua, statbuf.st_dev);
+	lua_pushnumber(lua, statbuf->st_dev);
 	lua_rawset(lua, t);
 	lua_pushstring(lua, "ino");
-	lua_pushnumber(lua, statbuf.st_ino);
+	lua_pushnumber(lua, statbuf->st_ino);
 	lua_rawset(lua, t);
 	lua_pushstring(lua, "mode");
-	lua_pushnumber(lua, statbuf.st_mode);
+	lua_pushnumber(lua, statbuf->st_mode);
 	lua_rawset(lua, t);
 	lua_pushstring(lua, "nlink");
-	lua_pushnumber(lua, statbuf.st_nlink);
+	lua_pushnumber(lua, statbuf->st_nlink);
 	lua_rawset(lua, t);
 	lua_pushstring(lua, "uid");
-	lua_pushnumber(lua, statbuf.st_uid);
+	lua_pushnumber(lua, statbuf->st_uid);
 	lua_rawset(lua, t);
 	lua_pushstring(lua, "gid");
-	lua_pushnumber(lua, statbuf.st_gid);
+	lua_pushnumber(lua, statbuf->st_gid);
 	lua_rawset(lua, t);
 	lua_pushstring(lua, "rdev");
-	lua_pushnumber(lua, statbuf.st_rdev);
+	lua_pushnumber(lua, statbuf->st_rdev);
 	lua_rawset(lua, t);
 	lua_pushstring(lua, "size");
-	lua_pushnumber(lua, statbuf.st_size);
+	lua_pushnumber(lua, statbuf->st_size);
 	lua_rawset(lua, t);
 	lua_pushstring(lua, "atime");
-	lua_pushnumber(lua, statbuf.st_atime);
+	lua_pushnumber(lua, statbuf->st_atime);
 	lua_rawset(lua, t);
 	lua_pushstring(lua, "atime_nsec");
-	lua_pushnumber(lua, statbuf.st_atim.tv_nsec);
+	lua_pushnumber(lua, statbuf->st_atim.tv_nsec);
 	lua_rawset(lua, t);
 	lua_pushstring(lua, "mtime");
-	lua_pushnumber(lua, statbuf.st_mtim.tv_sec);
+	lua_pushnumber(lua, statbuf->st_mtim.tv_sec);
 	lua_rawset(lua, t);
 	lua_pushstring(lua, "mtime_nsec");
-	lua_pushnumber(lua, statbuf.st_mtim.tv_nsec);
+	lua_pushnumber(lua, statbuf->st_mtim.tv_nsec);
 	lua_rawset(lua, t);
 	lua_pushstring(lua, "ctime");
-	lua_pushnumber(lua, statbuf.st_ctime);
+	lua_pushnumber(lua, statbuf->st_ctime);
 	lua_rawset(lua, t);
 	lua_pushstring(lua, "ctime_nsec");
-	lua_pushnumber(lua, statbuf.st_ctim.tv_nsec);
+	lua_pushnumber(lua, statbuf->st_ctim.tv_nsec);
 	lua_rawset(lua, t);
 	lua_pushstring(lua, "blksize");
-	lua_pushnumber(lua, statbuf.st_blksize);
+	lua_pushnumber(lua, statbuf->st_blksize);
 	lua_rawset(lua, t);
 	lua_pushstring(lua, "blocks");
-	lua_pushnumber(lua, statbuf.st_blocks);
+	lua_pushnumber(lua, statbuf->st_blocks);
 	lua_rawset(lua, t);
 	lua_pushstring(lua, "type");
+	lua_pushstring(lua, file_type(statbuf->st_mode));
+	lua_rawset(lua, t);
+}
+
+static int
+get_file_statistics(lua_State *lua)
+{
+	const char *p = luaL_checkstring(lua, 1);
+	static struct stat statbuf;
+	int fl = lua_gettop(lua) > 1 && lua_toboolean(lua, 2);
+	int s;
 
-	switch(statbuf.st_mode & S_IFMT) {
-	case S_IFBLK: lua_pushstring(lua, "block-special"); break;
-	case S_IFCHR: lua_pushstring(lua, "character-special"); break;
-	case S_IFIFO: lua_pushstring(lua, "fifo-special"); break;
-	case S_IFREG: lua_pushstring(lua, "regular"); break;
-	case S_IFDIR: lua_pushstring(lua, "directory"); break;
-	case S_IFLNK: lua_pushstring(lua, "symbolic-link"); break;
-	case S_IFSOCK: lua_pushstring(lua, "socket"); break;
-	default: lua_pushstring(lua, "unknown");
+	if (!fl) {
+		s = lstat(p, &statbuf);
+	} else {
+		s = stat(p, &statbuf);
+	}
+
+	if (s < 0) {
+		lua_pushboolean(lua, 0);
+		lua_pushstring(lua, strerror(errno));
+		return 2;
+	}
+
+	push_stat(lua, &statbuf);
+	return 1;
+}
+
+/*
+ * Stat a vector of paths in one call. Returns a vector of stat tables,
+ * false for paths that can not be stat'ed.
+ */
+static int
+get_file_statistics_vector(lua_State *lua)
+{
+	struct stat statbuf;
+	const char *p;
+	int fl = lua_gettop(lua) > 1 && lua_toboolean(lua, 2);
+	int i, n, s;
+
+	luaL_checktype(lua, 1, LUA_TTABLE);
+	n = lua_objlen(lua, 1);
+
+	lua_createtable(lua, n, 0);
+	for (i = 1; i <= n; i++) {
+		lua_rawgeti(lua, 1, i);
+		p = lua_tostring(lua, -1);
+		if (p == NULL)
+			return luaL_error(lua, "statv: path %d is not a string", i);
+
+		if (!fl) {
+			s = lstat(p, &statbuf);
+		} else {
+			s = stat(p, &statbuf);
+		}
+		lua_pop(lua, 1); /* path is still referenced by the vector */
+
+		if (s < 0)
+			lua_pushboolean(lua, 0);
+		else
+			push_stat(lua, &statbuf);
+		lua_rawseti(lua, -2, i);
 	}
 
-	lua_rawset(lua, t);
 	return 1;
 }
 
@@ -216,6 +268,123 @@ get_directory(lua_State *lua)
 	return 1;
 }
 
+#define TYPE_DIR "le2lib.DIR"
+
+/*
+ * Type of a directory entry. Not all file systems fill in d_type, fall back
+ * to lstat'ing the entry.
+ */
+static const char *
+dirent_type(DIR *dir, struct dirent *de)
+{
+	struct stat statbuf;
+
+	switch (de->d_type) {
+	case DT_BLK: return "block-special";
+	case DT_CHR: return "character-special";
+	case DT_FIFO: return "fifo-special";
+	case DT_REG: return "regular";
+	case DT_DIR: return "directory";
+	case DT_LNK: return "symbolic-link";
+	case DT_SOCK: return "socket";
+	}
+
+	if (fstatat(dirfd(dir), de->d_name, &statbuf, AT_SYMLINK_NOFOLLOW) < 0)
+		return "unknown";
+
+	return file_type(statbuf.st_mode);
+}
+
+static int
+close_directory(lua_State *lua)
+{
+	DIR **dp = luaL_checkudata(lua, 1, TYPE_DIR);
+
+	if (*dp != NULL) {
+		closedir(*dp);
+		*dp = NULL;
+	}
+
+	return 0;
+}
+
+/*
+ * Open a directory for reading with read_directory(). The directory is
+ * closed at its end, by close_directory() or when collected.
+ */
+static int
+open_directory(lua_State *lua)
+{
+	const char *p = luaL_checkstring(lua, 1);
+	DIR **dp;
+
+	dp = lua_newuserdata(lua, sizeof(DIR *));
+	*dp = NULL;
+	if (luaL_newmetatable(lua, TYPE_DIR)) {
+		lua_pushcfunction(lua, close_directory);
+		lua_setfield(lua, -2, "__gc");
+	}
+	lua_setmetatable(lua, -2);
+
+	*dp = opendir(p);
+	if (*dp == NULL) {
+		lua_pushboolean(lua, 0);
+		lua_pushstring(lua, strerror(errno));
+		return 2;
+	}
+
+	return 1;
+}
+
+/*
+ * Read the next entry of a directory, in directory order. Returns name and
+ * type of the entry, nil at the end of the directory.
+ */
+static int
+read_directory(lua_State *lua)
+{
+	DIR **dp = luaL_checkudata(lua, 1, TYPE_DIR);
+	int df = lua_gettop(lua) > 1 && lua_toboolean(lua, 2);
+	struct dirent *de;
+	int e;
+
+	if (*dp == NULL) {
+		lua_pushnil(lua);
+		return 1;
+	}
+
+	for (;;) {
+		errno = 0;
+		de = readdir(*dp);
+
+		if (de == NULL) {
+			e = errno;
+			closedir(*dp);
+			*dp = NULL;
+
+			if (e) {
+				lua_pushboolean(lua, 0);
+				lua_pushstring(lua, strerror(e));
+				return 2;
+			}
+
+			lua_pushnil(lua);
+			return 1;
+		}
+
+		if (strcmp(de->d_name, ".") == 0 ||
+		    strcmp(de->d_name, "..") == 0)
+			    continue;
+
+		if (df || de->d_name[0] != '.')
+			break;
+	}
+
+	lua_pushstring(lua, de->d_name);
+	lua_pushstring(lua, dirent_type(*dp, de));
+	return 2;
+}
+
 static int
 file_exists(lua_State *lua)
 {
@@ -262,6 +431,69 @@ create_symlink(lua_State *lua)
 	return 1;
 }
 
+static int
+do_readlink(lua_State *lua)
+{
+	const char *path = luaL_checkstring(lua, 1);
+	char buf[PATH_MAX];
+	ssize_t len;
+
+	len = readlink(path, buf, sizeof(buf));
+	if (len < 0 || (size_t)len >= sizeof(buf)) {
+		lua_pushboolean(lua, 0);
+		lua_pushstring(lua, len < 0 ? strerror(errno) :
+		    strerror(ENAMETOOLONG));
+
+		return 2;
+	}
+
+	lua_pushlstring(lua, buf, len);
+	return 1;
+}
+
+static int
+do_getrusage_children(lua_State *lua)
+{
+	struct rusage ru;
+
+	if (getrusage(RUSAGE_CHILDREN, &ru) != 0) {
+		lua_pushboolean(lua, 0);
+		lua_pushstring(lua, strerror(errno));
+
+		return 2;
+	}
+
+	lua_newtable(lua);
+	lua_pushnumber(lua, ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6);
+	lua_setfield(lua, -2, "utime");
+	lua_pushnumber(lua, ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6);
+	lua_setfield(lua, -2, "stime");
+	lua_pushnumber(lua, ru.ru_maxrss);
+	lua_setfield(lua, -2, "maxrss");
+	lua_pushnumber(lua, ru.ru_inblock);
+	lua_setfield(lua, -2, "inblock");
+	lua_pushnumber(lua, ru.ru_oublock);
+	lua_setfield(lua, -2, "oublock");
+
+	return 1;
+}
+
+static int
+do_monotime(lua_State *lua)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+		lua_pushboolean(lua, 0);
+		lua_pushstring(lua, strerror(errno));
+
+		return 2;
+	}
+
+	lua_pushnumber(lua, ts.tv_sec + ts.tv_nsec / 1e9);
+	return 1;
+}
+
 static int
 do_hardlink(lua_State *lua)
 {
@@ -914,6 +1146,155 @@ signal_unblock(lua_State *lua)
 	return 0;
 }
 
+/*
+ * Sampling profiler. SIGPROF arrives every interval of CPU time used by the
+ * process. Like signal_handler, the signal handler only installs a count
+ * hook; the hook records the Lua stack and restores the previous hook, so
+ * the trace hook of e2lib keeps working. Samples are counted by stack in a
+ * table kept in the registry.
+ */
+#define PROFILE_MAXDEPTH 64
+
+static lua_State *profileL = NULL;
+static volatile sig_atomic_t profile_pending = 0;
+static lua_Hook profile_oldhook;
+static int profile_oldmask;
+static int profile_oldcount;
+
+static void
+profile_hook(lua_State *L, lua_Debug *unused)
+{
+	char stack[PROFILE_MAXDEPTH][128];
+	luaL_Buffer b;
+	lua_Debug ar;
+	int depth, i;
+
+	if (signal_shutdown) {
+		/* interrupt requested meanwhile, let lua_signal_handler run */
+		lua_sethook(L, lua_signal_handler,
+		    LUA_MASKCALL | LUA_MASKRET | LUA_MASKCOUNT, 1);
+	} else {
+		lua_sethook(L, profile_oldhook, profile_oldmask,
+		    profile_oldcount);
+	}
+	profile_pending = 0;
+
+	for (depth = 0; depth < PROFILE_MAXDEPTH &&
+	    lua_getstack(L, depth, &ar); depth++) {
+		lua_getinfo(L, "Sn", &ar);
+		if (*ar.what == 'C') {
+			snprintf(stack[depth], sizeof(stack[depth]), "[C] %s",
+			    ar.name ? ar.name : "?");
+		} else {
+			snprintf(stack[depth], sizeof(stack[depth]), "%s %s:%d",
+			    ar.name ? ar.name : "?", ar.short_src,
+			    ar.linedefined);
+		}
+	}
+	if (depth == 0)
+		return;
+
+	if (!lua_checkstack(L, 4))
+		return;
+
+	/* collapsed stack: outermost frame first, separated by ';' */
+	luaL_buffinit(L, &b);
+	for (i = depth - 1; i >= 0; i--) {
+		luaL_addstring(&b, stack[i]);
+		if (i > 0)
+			luaL_addchar(&b, ';');
+	}
+	luaL_pushresult(&b);
+
+	lua_getfield(L, LUA_REGISTRYINDEX, "le2lib.profile");
+	if (!lua_istable(L, -1)) {
+		lua_pop(L, 2);
+		return;
+	}
+	lua_pushvalue(L, -2);
+	lua_rawget(L, -2);
+	lua_pushvalue(L, -3);
+	lua_pushinteger(L, lua_tointeger(L, -2) + 1);
+	lua_rawset(L, -4);
+	lua_pop(L, 3);
+}
+
+static void
+profile_signal_handler(int sig)
+{
+	if (profile_pending || signal_shutdown || profileL == NULL)
+		return;
+
+	profile_pending = 1;
+	profile_oldhook = lua_gethook(profileL);
+	profile_oldmask = lua_gethookmask(profileL);
+	profile_oldcount = lua_gethookcount(profileL);
+	lua_sethook(profileL, profile_hook, LUA_MASKCOUNT, 1);
+}
+
+/* Start sampling every interval microseconds of CPU time */
+static int
+profile_start(lua_State *L)
+{
+	long usec = luaL_checkinteger(L, 1);
+	struct sigaction sa;
+	struct itimerval it;
+
+	if (usec <= 0)
+		return luaL_error(L, "profile_start: invalid interval");
+
+	lua_newtable(L);
+	lua_setfield(L, LUA_REGISTRYINDEX, "le2lib.profile");
+	profileL = L;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = profile_signal_handler;
+	sa.sa_flags = SA_RESTART;
+	sa.sa_mask = block_set;
+	if (sigaction(SIGPROF, &sa, NULL) < 0) {
+		lua_pushboolean(L, 0);
+		lua_pushstring(L, strerror(errno));
+		return 2;
+	}
+
+	it.it_interval.tv_sec = usec / 1000000;
+	it.it_interval.tv_usec = usec % 1000000;
+	it.it_value = it.it_interval;
+	if (setitimer(ITIMER_PROF, &it, NULL) < 0) {
+		lua_pushboolean(L, 0);
+		lua_pushstring(L, strerror(errno));
+		return 2;
+	}
+
+	lua_pushboolean(L, 1);
+	return 1;
+}
+
+/* Stop sampling, return the table of sample counts by collapsed stack */
+static int
+profile_stop(lua_State *L)
+{
+	struct itimerval it;
+
+	memset(&it, 0, sizeof(it));
+	setitimer(ITIMER_PROF, &it, NULL);
+	signal(SIGPROF, SIG_IGN);
+
+	if (profile_pending) {
+		/* the hook did not run yet */
+		lua_sethook(L, profile_oldhook, profile_oldmask,
+		    profile_oldcount);
+		profile_pending = 0;
+	}
+	profileL = NULL;
+
+	lua_getfield(L, LUA_REGISTRYINDEX, "le2lib.profile");
+	lua_pushnil(L);
+	lua_setfield(L, LUA_REGISTRYINDEX, "le2lib.profile");
+
+	return 1;
+}
+
 static int
 ioctl_tiocsig_sigint(lua_State *L)
 {
@@ -952,6 +1333,7 @@ do_forkpty(lua_State *L)
 static luaL_Reg lib[] = {
 	{ "chdir", change_directory },
 	{ "chmod", do_chmod },
+	{ "closedir", close_directory },
 	{ "closefrom", do_closefrom },
 	{ "cwd", get_working_directory },
 	{ "directory", get_directory },
@@ -960,13 +1342,20 @@ static luaL_Reg lib[] = {
 	{ "fork", lua_fork },
 	{ "forkpty", do_forkpty },
 	{ "getpid", do_getpid },
+	{ "getrusage_children", do_getrusage_children },
 	{ "hardlink", do_hardlink },
 	{ "ioctl_tiocsig_sigint", ioctl_tiocsig_sigint },
 	{ "kill", do_kill },
 	{ "mkdir", do_mkdir },
 	{ "mkdtemp", do_mkdtemp },
 	{ "mkstemp", do_mkstemp },
+	{ "monotime", do_monotime },
+	{ "opendir", open_directory },
 	{ "poll", poll_fd },
+	{ "profile_start", profile_start },
+	{ "profile_stop", profile_stop },
+	{ "readdir", read_directory },
+	{ "readlink", do_readlink },
 	{ "rename", do_rename },
 	{ "rmdir", do_rmdir },
 	{ "setenv", do_setenv },
@@ -976,6 +1365,7 @@ static luaL_Reg lib[] = {
 	{ "signal_reset", signal_reset },
 	{ "signal_unblock", signal_unblock },
 	{ "stat", get_file_statistics },
+	{ "statv", get_file_statistics_vector },
 	{ "symlink", create_symlink },
 	{ "umask", set_umask },
 	{ "uname_machine", do_uname_machine },
@@ -23,6 +23,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/file.h>
 
 #include <lua.h>
 #include <lualib.h>
@@ -490,6 +491,28 @@ eio_cloexec(lua_State *lua)
 	return 1;
 }
 
+static int
+eio_flock(lua_State *L)
+{
+	int fd, rc;
+
+	fd = luaL_checkinteger(L, 1);
+	luaL_checktype(L, 2, LUA_TBOOLEAN);
+
+	do {
+		rc = flock(fd, lua_toboolean(L, 2) ? LOCK_EX : LOCK_UN);
+	} while (rc < 0 && errno == EINTR);
+
+	if (rc < 0) {
+		lua_pushboolean(L, 0);
+		lua_pushstring(L, strerror(errno));
+		return 2;
+	}
+
+	lua_pushboolean(L, 1);
+	return 1;
+}
+
 static luaL_Reg lib[] = {
   { "cloexec", eio_cloexec },
   { "close", eio_close },
@@ -501,6 +524,7 @@ static luaL_Reg lib[] = {
   { "fflush", eio_fflush },
   { "fgetc", eio_fgetc },
   { "fileno", eio_fileno },
+  { "flock", eio_flock },
   { "fopen", eio_fopen },
   { "fread", eio_fread },
   { "fwrite", eio_fwrite },
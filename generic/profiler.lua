@@ -0,0 +1,110 @@
+--- Sampling profiler of the Lua code of the e2 tools. A timer interrupts the
+-- process every interval of CPU time it uses and the Lua call stack at that
+-- point is counted. The samples are written in the collapsed stack format,
+-- one "frame;frame;frame count" line per stack, as read by flamegraph.pl.
+-- @module generic.profiler
+
+-- Copyright (C) 2007-2016 emlix GmbH, see file AUTHORS
+--
+-- This file is part of e2factory, the emlix embedded build system.
+-- For more information see http://www.e2factory.org
+--
+-- e2factory is a registered trademark of emlix GmbH.
+--
+-- e2factory is free software: you can redistribute it and/or modify it under
+-- the terms of the GNU General Public License as published by the
+-- Free Software Foundation, either version 3 of the License, or (at your
+-- option) any later version.
+--
+-- This program is distributed in the hope that it will be useful, but WITHOUT
+-- ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+-- FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+-- more details.
+
+local profiler = {}
+local e2lib = require("e2lib")
+local eio = require("eio")
+local err = require("err")
+local le2lib = require("le2lib")
+local strict = require("strict")
+
+--- Default sampling rate in samples per second of CPU time.
+local DEFAULT_HZ = 1000
+
+local _path = false     -- profile file, false if not profiling
+local _pid = false      -- process profiling, children do not write
+
+--- Stop sampling and write the profile.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function profiler.write()
+    local rc, re, counts, stacks, out, nsamples
+
+    if not _path or e2lib.getpid() ~= _pid then
+        return true
+    end
+
+    counts = le2lib.profile_stop()
+    stacks = {}
+    nsamples = 0
+    for stack, count in pairs(counts or {}) do
+        table.insert(stacks, stack)
+        nsamples = nsamples + count
+    end
+    table.sort(stacks)
+
+    out = {}
+    for _,stack in ipairs(stacks) do
+        table.insert(out, string.format("%s %d\n", stack, counts[stack]))
+    end
+
+    rc, re = eio.file_write(_path, table.concat(out))
+    if not rc then
+        return false, err.new("writing profile failed"):cat(re)
+    end
+
+    e2lib.logf(3, "profiler: %d samples written to %s", nsamples, _path)
+    _path = false
+
+    return true
+end
+
+--- Cleanup function, writes the profile on exit.
+local function cleanup()
+    local rc, re = profiler.write()
+    if not rc then
+        e2lib.log(1, re:tostring())
+    end
+end
+
+--- Start sampling. The profile is written on exit.
+-- @param path Path to the profile file.
+-- @param hz Samples per second of CPU time. Optional.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function profiler.start(path, hz)
+    assertIsStringN(path)
+    assert(not _path, "profiler already started")
+
+    local rc, re
+
+    hz = hz or DEFAULT_HZ
+    assertIsNumber(hz)
+    assert(hz > 0 and hz <= 1000000)
+
+    _path = path
+    _pid = e2lib.getpid()
+    e2lib.register_cleanup("profiler:write", cleanup)
+
+    rc, re = le2lib.profile_start(math.floor(1000000 / hz))
+    if not rc then
+        _path = false
+        return false, err.new("starting the profiler failed: %s", re)
+    end
+
+    return true
+end
+
+return strict.lock(profiler)
+
+-- vim:sw=4:sts=4:et:
@@ -310,6 +310,8 @@ function tools.add_default_tools()
         patch = { name = "patch", flags = "", optional = false },
         gzip = { name = "gzip", flags = "", optional = false },
         unzip = { name = "unzip", flags = "", optional = false },
+        xz = { name = "xz", flags = "", optional = true },
+        zstd = { name = "zstd", flags = "", optional = true },
         ["e2-su-2.2"] = { name = buildconfig.BINDIR .. "/e2-su-2.2",
         flags = "", optional = false },
         sudo = { name = "sudo", optional = true, enable = false },
@@ -0,0 +1,162 @@
+--- Trace event recorder. Writes spans in the Trace Event JSON format, which
+-- chrome://tracing and Perfetto load directly. Spans are written as complete
+-- ("X") events when they end, nesting follows from their timestamps.
+-- @module generic.traceevent
+
+-- Copyright (C) 2007-2016 emlix GmbH, see file AUTHORS
+--
+-- This file is part of e2factory, the emlix embedded build system.
+-- For more information see http://www.e2factory.org
+--
+-- e2factory is a registered trademark of emlix GmbH.
+--
+-- e2factory is free software: you can redistribute it and/or modify it under
+-- the terms of the GNU General Public License as published by the
+-- Free Software Foundation, either version 3 of the License, or (at your
+-- option) any later version.
+--
+-- This program is distributed in the hope that it will be useful, but WITHOUT
+-- ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+-- FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+-- more details.
+
+local traceevent = {}
+package.loaded["traceevent"] = traceevent -- prevent module loading loop
+
+local e2lib = require("e2lib")
+local eio = require("eio")
+local err = require("err")
+local strict = require("strict")
+
+local _file = false     -- trace file, false if tracing is disabled
+local _pid = false      -- process writing the trace, children do not
+local _t0 = 0           -- start of the trace
+local _first = true     -- no event written yet
+
+--- Quote a string for JSON.
+-- @param s String.
+-- @return Quoted string.
+local function json_string(s)
+    s = string.gsub(tostring(s), '[%c"\\]', function(c)
+        if c == '"' or c == "\\" then
+            return "\\" .. c
+        elseif c == "\n" then
+            return "\\n"
+        elseif c == "\t" then
+            return "\\t"
+        end
+        return string.format("\\u%04x", string.byte(c))
+    end)
+
+    return '"' .. s .. '"'
+end
+
+--- Write one event.
+-- @param fields Vector of already formatted "key":value strings.
+local function emit(fields)
+    local sep = ",\n"
+    if _first then
+        sep = ""
+        _first = false
+    end
+
+    -- errors are ignored, a truncated trace is still useful
+    eio.fwrite(_file, sep .. "{" .. table.concat(fields, ",") .. "}")
+end
+
+--- Start writing a trace. Ends the trace on exit.
+-- @param path Path to the trace file.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function traceevent.open(path)
+    assertIsStringN(path)
+    assert(not _file, "trace already open")
+
+    local rc, re, file
+
+    file, re = eio.fopen(path, "w")
+    if not file then
+        return false, err.new("opening trace file failed"):cat(re)
+    end
+
+    rc, re = eio.fwrite(file, "[\n")
+    if not rc then
+        eio.fclose(file)
+        return false, err.new("writing trace file failed"):cat(re)
+    end
+
+    _file = file
+    _pid = e2lib.getpid()
+    _t0 = e2lib.monotime()
+
+    emit({ '"name":"process_name"', '"ph":"M"',
+        string.format('"pid":%d', _pid),
+        string.format('"args":{"name":%s}', json_string("e2factory")) })
+
+    e2lib.register_cleanup("traceevent:close", traceevent.close)
+
+    return true
+end
+
+--- End the trace and close the trace file.
+function traceevent.close()
+    if not _file or e2lib.getpid() ~= _pid then
+        return
+    end
+
+    eio.fwrite(_file, "\n]\n")
+    eio.fclose(_file)
+    _file = false
+end
+
+--- Start a span.
+-- @return Start time of the span, or false if tracing is disabled.
+function traceevent.begin()
+    if not _file then
+        return false
+    end
+
+    return e2lib.monotime()
+end
+
+--- End a span and write it to the trace.
+-- @param t1 Start time returned by begin(). Nothing is written if false.
+-- @param name Name of the span.
+-- @param cat Category of the span, e.g. "step" or "exec".
+-- @param args Table of additional string or number arguments. Optional.
+function traceevent.complete(t1, name, cat, args)
+    if not t1 or not _file or e2lib.getpid() ~= _pid then
+        return
+    end
+
+    local t2, fields, a
+
+    t2 = e2lib.monotime()
+    fields = {
+        '"name":' .. json_string(name),
+        '"cat":' .. json_string(cat),
+        '"ph":"X"',
+        string.format('"ts":%.0f', (t1 - _t0) * 1e6),
+        string.format('"dur":%.0f', (t2 - t1) * 1e6),
+        string.format('"pid":%d', _pid),
+        '"tid":1',
+    }
+
+    if args then
+        a = {}
+        for k,v in pairs(args) do
+            if type(v) == "number" then
+                table.insert(a, json_string(k) .. ":" .. tostring(v))
+            else
+                table.insert(a, json_string(k) .. ":" .. json_string(v))
+            end
+        end
+        table.insert(fields, '"args":{' .. table.concat(a, ",") .. "}")
+    end
+
+    emit(fields)
+end
+
+return strict.lock(traceevent)
+
+-- vim:sw=4:sts=4:et:
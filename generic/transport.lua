@@ -149,6 +149,19 @@ local function rsync_ssh_mkdir(opts, user, server, dir)
     return true, nil
 end
 
+--- Error of transport.fetch_file(), created on failure only as files are
+-- fetched by the thousands.
+-- @param surl Server URL.
+-- @param location Location relative to the server URL.
+-- @param destdir Destination directory.
+-- @param destname Destination file name.
+-- @param re Error object of the failing operation.
+-- @return Error object.
+local function fetch_error(surl, location, destdir, destname, re)
+    return err.new("downloading %s/%s to %s/%s",
+        surl, location, destdir, destname):cat(re)
+end
+
 --- Fetch a file from a server.
 -- @param surl url to the server
 -- @param location location relative to the server url
@@ -163,22 +176,20 @@ function transport.fetch_file(surl, location, destdir, destname)
     end
 
     local rc, re
-    local e = err.new("downloading %s/%s to %s/%s",
-        surl, location, destdir, destname)
     local u, re = url.parse(surl)
     if not u then
-        return false, e:cat(re)
+        return false, fetch_error(surl, location, destdir, destname, re)
     end
     -- create the destination directory
     rc, re = e2lib.mkdir_recursive(destdir)
     if not rc then
-        return false, e:cat(re)
+        return false, fetch_error(surl, location, destdir, destname, re)
     end
 
     local template = string.format("%s/%s.XXXXXX", destdir, destname)
     local tmpfile_path, re = e2lib.mktempfile(template)
     if not tmpfile_path then
-        return false, e:cat(re)
+        return false, fetch_error(surl, location, destdir, destname, re)
     end
     local tmpfile = e2lib.basename(tmpfile_path)
 
@@ -206,7 +217,7 @@ function transport.fetch_file(surl, location, destdir, destname)
 
         rc, re = e2lib.curl(curl_argv)
         if not rc then
-            return false, e:cat(re)
+            return false, fetch_error(surl, location, destdir, destname, re)
         end
     elseif u.transport == "file" then
         -- rsync "sourcefile" "destdir/destfile"
@@ -216,14 +227,14 @@ function transport.fetch_file(surl, location, destdir, destname)
         table.insert(argv, tmpfile_path)
         rc, re = e2lib.rsync(argv)
         if not rc then
-            return false, e:cat(re)
+            return false, fetch_error(surl, location, destdir, destname, re)
         end
     elseif u.transport == "rsync+ssh" then
         local sdir = e2lib.join("/", u.path, location)
         local src =  rsync_quote_remote(u.user, u.servername, sdir)
         rc, re = rsync_ssh({}, src, tmpfile_path)
         if not rc then
-            return false, e:cat(re)
+            return false, fetch_error(surl, location, destdir, destname, re)
         end
     elseif u.transport == "scp" or
         u.transport == "ssh" then
@@ -239,17 +250,17 @@ function transport.fetch_file(surl, location, destdir, destname)
 
         rc, re = e2lib.scp({ sourcefile , tmpfile_path })
         if not rc then
-            return false, e:cat(re)
+            return false, fetch_error(surl, location, destdir, destname, re)
         end
     else
-        e:append("fetch file: unhandled transport: %s", u.transport)
-        return false, e
+        return false, fetch_error(surl, location, destdir, destname,
+            err.new("fetch file: unhandled transport: %s", u.transport))
     end
     -- Move the file into place atomically. This may fail when the copy
     -- operation above failed silently (looking at rsync here).
     rc, re = e2lib.rename(tmpfile_path, e2lib.join(destdir, destname))
     if not rc then
-        return false, e:cat(re)
+        return false, fetch_error(surl, location, destdir, destname, re)
     end
     return true
 end
@@ -464,6 +475,135 @@ function transport.push_file(sourcefile, durl, location, push_permissions, try_h
     return true, nil
 end
 
+--- Push the contents of a directory to a server in a single transfer. The
+-- destination directory tree is created once, instead of once per file as
+-- with push_file().
+-- @param sourcedir Local directory.
+-- @param durl Url to the destination server.
+-- @param location Destination directory relative to the server url.
+-- @param push_permissions string: permissions to use on the destination
+--        side. Works with rsync+ssh and file only.
+-- @param ignore_existing True to skip files that already exist on the
+--        destination side. Works with rsync+ssh and file only, other
+--        transports overwrite them.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function transport.push_directory(sourcedir, durl, location, push_permissions,
+    ignore_existing)
+    assertIsStringN(sourcedir)
+    assertIsStringN(durl)
+    assertIsStringN(location)
+    assert(push_permissions == nil or type(push_permissions) == "string")
+    assert(ignore_existing == nil or type(ignore_existing) == "boolean")
+
+    local rc, re, e, u, destdir, rsync_argv
+
+    durl = string.format("%s/%s", durl, location)
+    e = err.new("uploading directory %s to %s", sourcedir, durl)
+
+    u, re = url.parse(durl)
+    if not u then
+        return false, e:cat(re)
+    end
+
+    destdir = string.format("/%s", u.path)
+
+    rsync_argv = {}
+    if push_permissions then
+        table.insert(rsync_argv, "--perms")
+        table.insert(rsync_argv, "--chmod")
+        table.insert(rsync_argv, push_permissions)
+    end
+    if ignore_existing then
+        table.insert(rsync_argv, "--ignore-existing")
+    end
+
+    if u.transport == "file" then
+        local mode = nil
+
+        if push_permissions then
+            mode, re = e2lib.parse_mode(push_permissions)
+            if not mode then
+                return false, e:cat(re)
+            end
+        end
+
+        rc, re = e2lib.mkdir_recursive(destdir, mode)
+        if not rc then
+            return false, e:cat(re)
+        end
+
+        table.insert(rsync_argv, "-r")
+        rc, re = rsync_ssh(rsync_argv, sourcedir .. "/", destdir .. "/")
+        if not rc then
+            return false, e:cat(re)
+        end
+    elseif u.transport == "rsync+ssh" then
+        rc, re = rsync_ssh_mkdir(rsync_argv, u.user, u.servername, destdir)
+        if not rc then
+            return false, e:cat(re)
+        end
+
+        table.insert(rsync_argv, "-r")
+        rc, re = rsync_ssh(rsync_argv, sourcedir .. "/",
+            rsync_quote_remote(u.user, u.servername, destdir .. "/"))
+        if not rc then
+            return false, e:cat(re)
+        end
+    elseif u.transport == "scp" or
+        u.transport == "ssh" then
+        local user = ""
+        if u.user then
+            user = string.format("%s@", u.user)
+        end
+
+        if _scp_warning then
+            e2lib.warnf("WOTHER",
+                "ssh:// and scp:// transports may create incomplete uploads,"..
+                " please consider using rsync")
+            _scp_warning = false
+        end
+
+        if _scp_warning_pp and push_permissions then
+            e2lib.warnf("WOTHER",
+                "ssh:// and scp:// transports ignore the push_permissions "..
+                "setting, please consider using rsync")
+            _scp_warning_pp = false
+        end
+
+        rc, re = e2lib.ssh_remote_cmd(u, { "mkdir", "-p", destdir })
+        if not rc then
+            return false, e:cat(re)
+        end
+
+        -- copy the top level entries, scp -r of the directory itself would
+        -- nest it if the destination exists.
+        local scp_argv = { "-r" }
+        for f, re in e2lib.directory(sourcedir, true) do
+            if not f then
+                return false, e:cat(re)
+            end
+            table.insert(scp_argv, e2lib.join(sourcedir, f))
+        end
+
+        if #scp_argv == 1 then
+            return true
+        end
+
+        table.insert(scp_argv, string.format("%s%s:%s/", user,
+            u.servername, e2lib.shquote(destdir)))
+        rc, re = e2lib.scp(scp_argv)
+        if not rc then
+            return false, e:cat(re)
+        end
+    else
+        return false, e:cat("uploading files to %s:// transports is not "..
+            "supported", u.transport)
+    end
+
+    return true
+end
+
 return strict.lock(transport)
 
 -- vim:sw=4:sts=4:et:
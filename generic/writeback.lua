@@ -0,0 +1,493 @@
+--- Asynchronous writeback queue. Pushes files from the local cache to their
+-- servers in the background, running a bounded number of uploads in
+-- parallel. Queued writebacks are recorded in a journal, writebacks that did
+-- not finish before exit are resumed when the queue is enabled again.
+-- Uploads run in no particular order, except for barriers: files marking
+-- something complete, like a result manifest, are only uploaded after all
+-- writebacks queued before them have succeeded.
+-- @module generic.writeback
+
+-- Copyright (C) 2007-2016 emlix GmbH, see file AUTHORS
+--
+-- This file is part of e2factory, the emlix embedded build system.
+-- For more information see http://www.e2factory.org
+--
+-- e2factory is a registered trademark of emlix GmbH.
+--
+-- e2factory is free software: you can redistribute it and/or modify it under
+-- the terms of the GNU General Public License as published by the
+-- Free Software Foundation, either version 3 of the License, or (at your
+-- option) any later version.
+--
+-- This program is distributed in the hope that it will be useful, but WITHOUT
+-- ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+-- FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+-- more details.
+
+local writeback = {}
+local cache = require("cache")
+local e2lib = require("e2lib")
+local eio = require("eio")
+local err = require("err")
+local le2lib = require("le2lib")
+local strict = require("strict")
+
+--- Number of attempts to upload a file before giving up for this run.
+local MAX_ATTEMPTS = 3
+
+--- Writeback job table.
+-- @table job
+-- @field id Unique job id, used in the journal.
+-- @field server Server name.
+-- @field location Location of the file on the server and in the cache.
+-- @field try_hardlink Hardlink instead of copying if possible.
+-- @field barrier Upload only after all jobs with a lower id succeeded.
+-- @field size Size of the file in bytes, 0 if unknown.
+-- @field attempts Number of upload attempts so far.
+
+local _journal = false  -- path to the journal file
+local _jobs = 0         -- maximum number of parallel uploads
+local _nextid = 1       -- next job id
+local _queue = {}       -- vector of waiting jobs
+local _running = {}     -- running jobs indexed by pid
+local _nrunning = 0
+local _ndone = 0
+local _nfailed = 0
+local _failedid = false -- lowest id of a job that failed for this run
+local _bytes = 0        -- bytes uploaded in this run
+local _start = false    -- start time of the first upload in this run
+
+--- Append a record to the journal.
+-- @param fmt Format string.
+-- @param ... Arguments for the format string.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+local function journal_append(fmt, ...)
+    local rc, re, file
+
+    file, re = eio.fopen(_journal, "a")
+    if not file then
+        return false, re
+    end
+
+    rc, re = eio.fwrite(file, string.format(fmt, ...))
+    if not rc then
+        eio.fclose(file)
+        return false, re
+    end
+
+    return eio.fclose(file)
+end
+
+--- Load the journal and return all writebacks that did not finish.
+-- Records: "add <id> <server> <flags> <location>" and "done <id>", fields
+-- are separated by tabs. Flags are the try_hardlink digit, followed by "b"
+-- for a barrier.
+-- @return Vector of job tables sorted by id, or false on error.
+-- @return Error object on failure.
+local function journal_load()
+    local rc, re, file, line, jobs, pending
+
+    jobs = {}
+    if not e2lib.exists(_journal) then
+        return jobs
+    end
+
+    file, re = eio.fopen(_journal, "r")
+    if not file then
+        return false, re
+    end
+
+    pending = {}
+    while true do
+        line, re = eio.readline(file)
+        if not line then
+            eio.fclose(file)
+            return false, re
+        elseif line == "" then
+            break
+        end
+
+        local op, rest = line:match("^(%a+)\t(.*)\n$")
+        if op == "add" then
+            local id, server, hl, b, location =
+                rest:match("^(%d+)\t([^\t]+)\t([01])(b?)\t(.+)$")
+            if id then
+                pending[tonumber(id)] = {
+                    id = tonumber(id),
+                    server = server,
+                    location = location,
+                    try_hardlink = (hl == "1"),
+                    barrier = (b == "b"),
+                    size = 0,
+                    attempts = 0,
+                }
+            end
+        elseif op == "done" and rest:match("^%d+$") then
+            pending[tonumber(rest)] = nil
+        else
+            e2lib.logf(3, "writeback: ignoring malformed journal line: %q",
+                line)
+        end
+    end
+
+    rc, re = eio.fclose(file)
+    if not rc then
+        return false, re
+    end
+
+    for id, job in pairs(pending) do
+        table.insert(jobs, job)
+        if id >= _nextid then
+            _nextid = id + 1
+        end
+    end
+    table.sort(jobs, function(a, b) return a.id < b.id end)
+
+    return jobs
+end
+
+--- Format the add record of a job for the journal.
+-- @param job Job table.
+-- @return Journal line.
+local function journal_add_record(job)
+    return string.format("add\t%d\t%s\t%s%s\t%s\n", job.id, job.server,
+        job.try_hardlink and "1" or "0", job.barrier and "b" or "",
+        job.location)
+end
+
+--- Replace the journal with the add records of the given jobs.
+-- Removes the journal if no jobs are left.
+-- @param jobs Vector of job tables.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+local function journal_rewrite(jobs)
+    local rc, re, out, tmp
+
+    if #jobs == 0 then
+        if e2lib.exists(_journal) then
+            return e2lib.unlink(_journal)
+        end
+        return true
+    end
+
+    out = {}
+    for _,job in ipairs(jobs) do
+        table.insert(out, journal_add_record(job))
+    end
+
+    tmp = _journal .. ".tmp"
+    rc, re = eio.file_write(tmp, table.concat(out))
+    if not rc then
+        return false, re
+    end
+
+    return e2lib.rename(tmp, _journal)
+end
+
+--- Upload a file in a child process. The child marks the job as done in the
+-- journal itself, so a finished upload is recorded even if the parent
+-- does not wait for it.
+-- @param job Job table.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+local function job_start(job)
+    local rc, re, pid
+
+    -- flush all buffers before we fork
+    rc, re = eio.fflush(nil)
+    if not rc then
+        return false, re
+    end
+
+    job.attempts = job.attempts + 1
+    e2lib.logf(3, "writeback: pushing %s:%s (attempt %d)", job.server,
+        job.location, job.attempts)
+
+    le2lib.signal_block()
+    pid, re = e2lib.fork()
+    if not pid then
+        le2lib.signal_unblock()
+        return false, re
+    elseif pid == 0 then
+        e2lib.signal_reset()
+        le2lib.signal_unblock()
+
+        rc, re = cache.writeback_file(cache.cache(), job.server, job.location,
+            { try_hardlink = job.try_hardlink })
+        if rc then
+            rc, re = journal_append("done\t%d\n", job.id)
+        end
+        if not rc then
+            e2lib.log(3, re:tostring())
+        end
+
+        -- do not run the cleanup handlers of the parent
+        os.exit(rc and 0 or 1)
+    end
+    le2lib.signal_unblock()
+
+    if not _start then
+        _start = os.time()
+    end
+
+    _running[pid] = job
+    _nrunning = _nrunning + 1
+
+    return true
+end
+
+--- Handle a terminated upload.
+-- @param pid Process ID of the terminated child.
+-- @param status Exit status of the child.
+local function job_finished(pid, status)
+    local job = _running[pid]
+
+    _running[pid] = nil
+    _nrunning = _nrunning - 1
+
+    if status == 0 then
+        _ndone = _ndone + 1
+        _bytes = _bytes + job.size
+        return
+    end
+
+    if job.attempts < MAX_ATTEMPTS then
+        e2lib.logf(3, "writeback: pushing %s:%s failed, retrying",
+            job.server, job.location)
+        table.insert(_queue, job)
+        return
+    end
+
+    _nfailed = _nfailed + 1
+    if not _failedid or job.id < _failedid then
+        _failedid = job.id
+    end
+    e2lib.warnf("WOTHER", "writeback of %s:%s failed %d times, "..
+        "it will be retried by the next run", job.server, job.location,
+        job.attempts)
+end
+
+--- Check whether a barrier job may start: all jobs queued before it must
+-- have succeeded. If one failed for this run, the barrier is dropped from
+-- the queue and left in the journal for the next run.
+-- @param job Job table of a barrier.
+-- @return "start", "wait" or "drop".
+local function barrier_state(job)
+    if _failedid and _failedid < job.id then
+        return "drop"
+    end
+
+    for _,other in pairs(_running) do
+        if other.id < job.id then
+            return "wait"
+        end
+    end
+    for _,other in ipairs(_queue) do
+        if other.id < job.id then
+            return "wait"
+        end
+    end
+
+    return "start"
+end
+
+--- Take the next job that may start from the queue. Barriers that must
+-- wait stay queued, later jobs may pass them.
+-- @return Job table or nil if no job may start.
+local function next_job()
+    local i = 1
+
+    while i <= #_queue do
+        local job, state
+
+        job = _queue[i]
+        state = job.barrier and barrier_state(job) or "start"
+        if state == "start" then
+            return table.remove(_queue, i)
+        elseif state == "drop" then
+            table.remove(_queue, i)
+            _nfailed = _nfailed + 1
+            e2lib.warnf("WOTHER", "not writing back %s:%s as an earlier "..
+                "writeback failed, it will be retried by the next run",
+                job.server, job.location)
+        else
+            i = i + 1
+        end
+    end
+
+    return nil
+end
+
+--- Writeback queue callback for the cache.
+-- @param server Server name.
+-- @param location Location of the file on the server.
+-- @param sourcefile Path to the file in the cache.
+-- @param try_hardlink Hardlink instead of copying if possible.
+-- @param barrier Upload only after all earlier writebacks succeeded.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+local function enqueue(server, location, sourcefile, try_hardlink, barrier)
+    local rc, re, job, sb
+
+    job = {
+        id = _nextid,
+        server = server,
+        location = location,
+        try_hardlink = try_hardlink,
+        barrier = barrier,
+        size = 0,
+        attempts = 0,
+    }
+    _nextid = _nextid + 1
+
+    sb = e2lib.stat(sourcefile)
+    if sb then
+        job.size = sb.size
+    end
+
+    rc, re = journal_append("%s", journal_add_record(job))
+    if not rc then
+        return false, re
+    end
+
+    table.insert(_queue, job)
+
+    return writeback.poll()
+end
+
+--- Enable the writeback queue for a cache. Writebacks left in the journal
+-- by an earlier run are queued again.
+-- @param c Cache object.
+-- @param journal Path to the journal file.
+-- @param jobs Maximum number of parallel uploads.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function writeback.enable(c, journal, jobs)
+    assertIsTable(c)
+    assertIsStringN(journal)
+    assertIsNumber(jobs)
+    assert(jobs > 0)
+
+    local rc, re, pending
+    local e = err.new("enabling the writeback queue failed")
+
+    _journal = journal
+    _jobs = jobs
+
+    pending, re = journal_load()
+    if not pending then
+        return false, e:cat(re)
+    end
+
+    rc, re = journal_rewrite(pending)
+    if not rc then
+        return false, e:cat(re)
+    end
+
+    for _,job in ipairs(pending) do
+        table.insert(_queue, job)
+    end
+
+    if #pending > 0 then
+        e2lib.logf(2, "writeback: resuming %d pending uploads", #pending)
+    end
+
+    cache.set_writeback_queue(c, enqueue)
+    e2lib.register_cleanup("writeback:report", writeback.report)
+
+    return writeback.poll()
+end
+
+--- Reap finished uploads and start queued ones, up to the configured number
+-- of parallel uploads. Does not block.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function writeback.poll()
+    local rc, re, status, cpid
+
+    for pid,_ in pairs(_running) do
+        status, cpid = e2lib.wait(pid, true)
+        if not status then
+            return false, cpid
+        elseif cpid ~= 0 then
+            job_finished(pid, status)
+        end
+    end
+
+    while _nrunning < _jobs do
+        local job = next_job()
+        if not job then
+            break
+        end
+
+        rc, re = job_start(job)
+        if not rc then
+            return false, re
+        end
+    end
+
+    return true
+end
+
+--- Block until all queued uploads have terminated.
+-- @return True if all uploads succeeded, false otherwise.
+-- @return Error object on failure.
+function writeback.wait()
+    local rc, re, status, cpid
+
+    if _journal then
+        e2lib.logf(2, "writeback: waiting for %d uploads",
+            _nrunning + #_queue)
+    end
+
+    while true do
+        rc, re = writeback.poll()
+        if not rc then
+            return false, re
+        end
+
+        local pid = next(_running)
+        if not pid then
+            break
+        end
+
+        status, cpid = e2lib.wait(pid, false)
+        if not status then
+            return false, cpid
+        end
+        job_finished(pid, status)
+    end
+
+    if _nfailed > 0 then
+        return false, err.new("%d writebacks failed", _nfailed)
+    end
+
+    return true
+end
+
+--- Log queue depth and upload throughput.
+function writeback.report()
+    local deltat
+
+    if not _journal then
+        return
+    end
+
+    deltat = 0
+    if _start then
+        deltat = os.difftime(os.time(), _start)
+    end
+
+    e2lib.logf(2, "writeback: %d done, %d failed, %d running, %d queued, "..
+        "%d bytes in %ds (%d KiB/s)", _ndone, _nfailed, _nrunning, #_queue,
+        _bytes, deltat, _bytes / 1024 / math.max(deltat, 1))
+
+    if _nrunning + #_queue > 0 then
+        e2lib.logf(3, "writeback: unfinished uploads are resumed by the next run")
+    end
+end
+
+return strict.lock(writeback)
+
+-- vim:sw=4:sts=4:et:
@@ -34,8 +34,15 @@
  * call with e2-su-2.2 <command> <base> ...
  *  base/e2factory-chroot   - chroot marker file
  *  base/chroot/            - chroot environment
+ *  base/e2factory-binds    - optional list of directories bind mounted
+ *                            by chroot_bind_2_3, read-only by default
+ *
+ * base/chroot/ may be a tmpfs, mounted by mount_tmpfs_2_3 before the chroot
+ * is set up and unmounted by umount_tmpfs_2_3 before it is removed.
  */
 
+#define _GNU_SOURCE /* unshare() */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -44,6 +51,11 @@
 #include <limits.h>
 #include <grp.h>
 #include <libgen.h>
+#include <sched.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <linux/magic.h>
 
 /* #define DEBUG 1 */
 
@@ -131,6 +143,103 @@ void assert_chroot_environment_2_3(char *base)
 	return;
 }
 
+/* Bind mount the directories listed in base/e2factory-binds into the chroot,
+ * in a new mount namespace that ends with the chroot command. Each line holds
+ * the absolute path of a directory owned by the calling user and a directory
+ * in the chroot, relative to it, separated by a tab. The mount is read-only
+ * unless a third field "rw" follows.
+ */
+void bind_mounts_2_3(char *base, char *path)
+{
+	char name[PATH_MAX], line[2*PATH_MAX+5];
+	char dst[PATH_MAX], real[PATH_MAX], root[PATH_MAX];
+	char *src, *rel, *flags;
+	size_t rootlen;
+	struct stat st;
+	uid_t uid = getuid();
+	FILE *f;
+
+	snprintf(name, sizeof(name), "%s/e2factory-binds", base);
+	name[sizeof(name)-1]=0;
+	if(access(name, R_OK)) {
+		perr("can't read bind list");
+	}
+	f = fopen(name, "r");
+	if(!f) {
+		perr("can't read bind list");
+	}
+	if(!realpath(path, root)) {
+		perr("can't resolve chroot path");
+	}
+	rootlen = strlen(root);
+
+	if(unshare(CLONE_NEWNS)) {
+		perror("can't unshare mount namespace");
+		exit(99);
+	}
+	/* keep the mounts from propagating to the host */
+	if(mount(NULL, "/", NULL, MS_REC|MS_PRIVATE, NULL)) {
+		perror("can't make mounts private");
+		exit(99);
+	}
+
+	while(fgets(line, sizeof(line), f)) {
+		src = line;
+		rel = strchr(line, '\t');
+		if(!rel) {
+			perr("malformed bind list");
+		}
+		*rel++ = 0;
+		rel[strcspn(rel, "\n")] = 0;
+		flags = strchr(rel, '\t');
+		if(flags) {
+			*flags++ = 0;
+			if(strcmp(flags, "rw")) {
+				perr("malformed bind list");
+			}
+		}
+
+		if(src[0] != '/' || stat(src, &st) || !S_ISDIR(st.st_mode) ||
+		    st.st_uid != uid) {
+			perr("bind source is not a directory owned by the user");
+		}
+		snprintf(dst, sizeof(dst), "%s/%s", path, rel);
+		dst[sizeof(dst)-1] = 0;
+		if(!realpath(dst, real) || strncmp(real, root, rootlen) ||
+		    real[rootlen] != '/') {
+			perr("bind destination is not in the chroot");
+		}
+
+		if(mount(src, real, NULL, MS_BIND, NULL)) {
+			perror("can't bind mount");
+			exit(99);
+		}
+		if(!flags &&
+		    mount(NULL, real, NULL, MS_BIND|MS_REMOUNT|MS_RDONLY, NULL)) {
+			perror("can't remount read-only");
+			exit(99);
+		}
+	}
+	fclose(f);
+}
+
+/* Check that base/chroot is a directory and not a symlink. If owner is not
+ * -1, it must be owned by owner, if tmpfs is set, it must be a tmpfs. */
+void assert_chroot_dir_2_3(char *path, uid_t owner, int tmpfs)
+{
+	struct stat st;
+	struct statfs sfs;
+	if(lstat(path, &st) || !S_ISDIR(st.st_mode)) {
+		perr("chroot is not a directory");
+	}
+	if(owner != (uid_t)-1 && st.st_uid != owner) {
+		perr("chroot is not owned by the user");
+	}
+	if(tmpfs && (statfs(path, &sfs) || sfs.f_type != TMPFS_MAGIC)) {
+		perr("chroot is not a tmpfs");
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	if(argc < 3) {
@@ -249,10 +358,44 @@ int main(int argc, char *argv[])
 		execv(chroot_tool, arg);
 		perror("can't exec");
 		exit(99);
+	} else if(!strcmp(cmd, "chroot_bind_2_3")) {
+		/* chroot_bind_2_3 <base> ... */
+		int i;
+		char *arg[256];
+		char *base = argv[2];
+		char path[PATH_MAX];
+		snprintf(path, sizeof(path), "%s/chroot", base);
+		path[sizeof(path)-1] = 0;
+		assert_chroot_environment_2_3(base);
+		bind_mounts_2_3(base, path);
+		arg[0] = basename(chroot_tool);
+		arg[1] = path;
+		for (i=3; i < argc; i++) {
+			arg[i-1] = argv[i];
+		}
+		arg[i-1] = 0;
+		print_arg(arg);
+		setuid_root();
+		execv(chroot_tool, arg);
+		perror("can't exec");
+		exit(99);
+	} else if(!strcmp(cmd, "bind_check_2_3")) {
+		/* bind_check_2_3 <base>, fails without mount namespaces */
+		if(argc != 3) {
+			perr("wrong number of arguments");
+		}
+		assert_chroot_environment_2_3(argv[2]);
+		if(unshare(CLONE_NEWNS)) {
+			perror("can't unshare mount namespace");
+			exit(99);
+		}
+		exit(0);
 	} else if(!strcmp(cmd, "extract_tar_2_3")) {
-		/* extract_tar_2_3 <base> <tartype> <file> */
+		/* extract_tar_2_3 <base> <tartype> <file> [<threads>] */
 		char *arg[256];
-		if(argc != 5) {
+		char threads_env[32];
+		long threads = -1;
+		if(argc != 5 && argc != 6) {
 			perr("wrong number of arguments");
 		}
 		char *base = argv[2];
@@ -262,6 +405,14 @@ int main(int argc, char *argv[])
 		path[sizeof(path)-1] = 0;
 		char *tartype = argv[3];
 		char *file = argv[4];
+		if(argc == 6) {
+			char *end;
+			threads = strtol(argv[5], &end, 10);
+			if(argv[5][0] == 0 || *end != 0 || threads < 0 ||
+			    threads > 4096) {
+				perr("wrong threads argument");
+			}
+		}
 		int n = 0;
 		arg[n++] = basename(tar_tool);
 		arg[n++] = "-C";
@@ -270,6 +421,10 @@ int main(int argc, char *argv[])
 			arg[n++] = "--gzip";
 		} else if(!strcmp(tartype, "tar.bz2")) {
 			arg[n++] = "--bzip2";
+		} else if(!strcmp(tartype, "tar.xz")) {
+			arg[n++] = "--xz";
+		} else if(!strcmp(tartype, "tar.zst")) {
+			arg[n++] = "--zstd";
 		} else if(!strcmp(tartype, "tar")) {
 			/* nothing */
 		} else {
@@ -280,6 +435,14 @@ int main(int argc, char *argv[])
 		arg[n++] = NULL;
 		print_arg(arg);
 		setuid_root();
+		/* thread count for the decompressor, 0 is one thread per cpu */
+		if(threads >= 0 && !strcmp(tartype, "tar.xz")) {
+			snprintf(threads_env, sizeof(threads_env), "-T%ld", threads);
+			setenv("XZ_DEFAULTS", threads_env, 1);
+		} else if(threads >= 0 && !strcmp(tartype, "tar.zst")) {
+			snprintf(threads_env, sizeof(threads_env), "%ld", threads);
+			setenv("ZSTD_NBTHREADS", threads_env, 1);
+		}
 		execv(tar_tool, arg);
 		perror("can't exec");
 		exit(99);
@@ -303,6 +466,49 @@ int main(int argc, char *argv[])
 		execv(chown_tool, arg);
 		perror("can't exec");
 		exit(99);
+	} else if(!strcmp(cmd, "mount_tmpfs_2_3")) {
+		/* mount_tmpfs_2_3 <base> <size> */
+		char opts[64];
+		if(argc != 4) {
+			perr("wrong number of arguments");
+		}
+		char *base = argv[2];
+		assert_chroot_environment_2_3(base);
+		char path[PATH_MAX];
+		snprintf(path, sizeof(path), "%s/chroot", base);
+		path[sizeof(path)-1] = 0;
+		char *end;
+		unsigned long long size = strtoull(argv[3], &end, 10);
+		if(argv[3][0] < '1' || argv[3][0] > '9' || *end != 0) {
+			perr("wrong size argument");
+		}
+		/* a new, empty chroot only */
+		assert_chroot_dir_2_3(path, getuid(), 0);
+		snprintf(opts, sizeof(opts), "size=%llu,mode=0755", size);
+		setuid_root();
+		if(mount("tmpfs", path, "tmpfs", 0, opts)) {
+			perror("can't mount tmpfs");
+			exit(99);
+		}
+		exit(0);
+	} else if(!strcmp(cmd, "umount_tmpfs_2_3")) {
+		/* umount_tmpfs_2_3 <base> */
+		if(argc != 3) {
+			perr("wrong number of arguments");
+		}
+		char *base = argv[2];
+		assert_chroot_environment_2_3(base);
+		char path[PATH_MAX];
+		snprintf(path, sizeof(path), "%s/chroot", base);
+		path[sizeof(path)-1] = 0;
+		assert_chroot_dir_2_3(path, (uid_t)-1, 1);
+		setuid_root();
+		/* lazily, a process left over from the build keeps it busy */
+		if(umount2(path, MNT_DETACH)) {
+			perror("can't unmount tmpfs");
+			exit(99);
+		}
+		exit(0);
 	} else if(!strcmp(cmd, "remove_chroot_2_3")) {
 		/* remove_chroot_2_3 <base> */
 		char *arg[256];
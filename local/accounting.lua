@@ -0,0 +1,328 @@
+--- Resource accounting of builds. Records wall and CPU time of every build
+-- step, and runs the build script of each result in its own cgroup (v2) if
+-- the host delegates a writable cgroup to the user. The cgroup provides the
+-- CPU time, peak memory and I/O bytes of the build script alone.
+-- @module local.accounting
+
+-- Copyright (C) 2007-2016 emlix GmbH, see file AUTHORS
+--
+-- This file is part of e2factory, the emlix embedded build system.
+-- For more information see http://www.e2factory.org
+--
+-- e2factory is a registered trademark of emlix GmbH.
+--
+-- e2factory is free software: you can redistribute it and/or modify it under
+-- the terms of the GNU General Public License as published by the
+-- Free Software Foundation, either version 3 of the License, or (at your
+-- option) any later version.
+--
+-- This program is distributed in the hope that it will be useful, but WITHOUT
+-- ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+-- FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+-- more details.
+
+local accounting = {}
+local e2lib = require("e2lib")
+local eio = require("eio")
+local err = require("err")
+local strict = require("strict")
+
+--- Mount point of the unified cgroup hierarchy.
+local CGROUP_ROOT = "/sys/fs/cgroup"
+
+--- Per result accounting table.
+-- @table acct
+-- @field name Result name.
+-- @field wall Wall time of all steps in seconds.
+-- @field cpu CPU time of all child processes in seconds.
+-- @field steps Vector of { name, wall, cpu } tables.
+-- @field build Resources of the build script, false if it did not run.
+--              Table with the fields wall, cpu_user, cpu_system and, if
+--              measured in a cgroup, memory_peak, io_read, io_write.
+
+local _acct = {}        -- acct tables indexed by result name
+local _order = {}       -- result names in build order
+local _cgroup = nil     -- parent cgroup of the builds, false if unavailable
+
+--- Read all lines of a small file.
+-- @param path Path to the file.
+-- @return Vector of lines without newline, or false on error.
+-- @return Error object on failure.
+local function read_lines(path)
+    local rc, re, file, line, lines
+
+    file, re = eio.fopen(path, "r")
+    if not file then
+        return false, re
+    end
+
+    lines = {}
+    while true do
+        line, re = eio.readline(file)
+        if not line then
+            eio.fclose(file)
+            return false, re
+        elseif line == "" then
+            break
+        end
+        table.insert(lines, (line:gsub("\n$", "")))
+    end
+
+    rc, re = eio.fclose(file)
+    if not rc then
+        return false, re
+    end
+
+    return lines
+end
+
+--- Get the accounting table of a result.
+-- @param resname Result name.
+-- @return acct table.
+local function acct(resname)
+    if not _acct[resname] then
+        _acct[resname] = {
+            name = resname,
+            wall = 0,
+            cpu = 0,
+            steps = {},
+            build = false,
+        }
+        table.insert(_order, resname)
+    end
+
+    return _acct[resname]
+end
+
+--- Remove the parent cgroup, registered as cleanup function.
+local function cgroup_remove()
+    if _cgroup then
+        e2lib.rmdir(_cgroup) -- ignore errors, builds may have left processes
+    end
+end
+
+--- Create the parent cgroup of the builds below the cgroup e2factory runs
+-- in. Enables the memory and io controllers if they are delegated.
+-- @return Path to the parent cgroup, or false if cgroups are unavailable.
+local function cgroup_parent()
+    local rc, re, lines, path, probe
+
+    if _cgroup ~= nil then
+        return _cgroup
+    end
+    _cgroup = false
+
+    if not e2lib.exists(e2lib.join(CGROUP_ROOT, "cgroup.controllers")) then
+        e2lib.log(3, "accounting: no cgroup v2 hierarchy")
+        return false
+    end
+
+    lines, re = read_lines("/proc/self/cgroup")
+    if not lines then
+        e2lib.logf(3, "accounting: %s", re:tostring())
+        return false
+    end
+
+    for _,line in ipairs(lines) do
+        if line:match("^0::/") then
+            path = e2lib.join(CGROUP_ROOT, line:sub(4))
+        end
+    end
+    if not path then
+        return false
+    end
+
+    path = e2lib.join(path, string.format("e2factory-%d", e2lib.getpid()))
+    rc, re = e2lib.mkdir(path)
+    if not rc then
+        e2lib.logf(3, "accounting: cgroup not delegated: %s", re:tostring())
+        return false
+    end
+    _cgroup = path
+    e2lib.register_cleanup("accounting:cgroup_remove", cgroup_remove)
+
+    -- optional, not all controllers may be delegated
+    eio.file_write(e2lib.join(path, "cgroup.subtree_control"), "+memory +io")
+
+    -- can we move a process into a child cgroup?
+    probe = e2lib.join(path, "probe")
+    rc, re = e2lib.mkdir(probe)
+    if rc then
+        rc, re = e2lib.callcmd({ "/bin/sh", "-c", 'echo $$ >"$0"',
+            e2lib.join(probe, "cgroup.procs") }, {})
+        e2lib.rmdir(probe)
+    end
+    if rc ~= 0 then
+        e2lib.log(3, "accounting: moving processes into a cgroup failed")
+        cgroup_remove()
+        _cgroup = false
+        return false
+    end
+
+    e2lib.logf(3, "accounting: using cgroup %s", path)
+    return _cgroup
+end
+
+--- Record a finished build step.
+-- @param resname Result name.
+-- @param stepname Step name.
+-- @param wall Wall time in seconds.
+-- @param cpu CPU time of the child processes in seconds.
+function accounting.step(resname, stepname, wall, cpu)
+    local a = acct(resname)
+
+    a.wall = a.wall + wall
+    a.cpu = a.cpu + cpu
+    table.insert(a.steps, { name = stepname, wall = wall, cpu = cpu })
+end
+
+--- Create a cgroup for the build script of a result and wrap the command,
+-- so it moves itself into the cgroup before it executes.
+-- @param resname Result name.
+-- @param cmd Command vector, modified in place.
+-- @return Path to the cgroup, or false if the build is not accounted in a
+--         cgroup.
+function accounting.cgroup_wrap(resname, cmd)
+    local rc, re, parent, cg
+
+    parent = cgroup_parent()
+    if not parent then
+        return false
+    end
+
+    cg = e2lib.join(parent, resname)
+    rc, re = e2lib.mkdir(cg)
+    if not rc then
+        e2lib.logf(3, "accounting: %s", re:tostring())
+        return false
+    end
+
+    for i,arg in ipairs({ "/bin/sh", "-c",
+        'echo $$ >"$0" 2>/dev/null; exec "$@"',
+        e2lib.join(cg, "cgroup.procs") }) do
+        table.insert(cmd, i, arg)
+    end
+
+    return cg
+end
+
+--- Record the resources used by the build script of a result.
+-- @param resname Result name.
+-- @param cg Path to the cgroup returned by cgroup_wrap(), or false.
+-- @param wall Wall time in seconds.
+-- @param ru1 Child resource usage before the build.
+-- @param ru2 Child resource usage after the build.
+function accounting.build(resname, cg, wall, ru1, ru2)
+    local lines, b
+
+    b = {
+        wall = wall,
+        cpu_user = ru2.utime - ru1.utime,
+        cpu_system = ru2.stime - ru1.stime,
+    }
+    acct(resname).build = b
+
+    if not cg then
+        return
+    end
+
+    lines = read_lines(e2lib.join(cg, "cpu.stat"))
+    for _,line in ipairs(lines or {}) do
+        local key, val = line:match("^(%S+) (%d+)$")
+        if key == "user_usec" then
+            b.cpu_user = tonumber(val) / 1e6
+        elseif key == "system_usec" then
+            b.cpu_system = tonumber(val) / 1e6
+        end
+    end
+
+    lines = read_lines(e2lib.join(cg, "memory.peak"))
+    if lines and lines[1] and lines[1]:match("^%d+$") then
+        b.memory_peak = tonumber(lines[1])
+    end
+
+    lines = read_lines(e2lib.join(cg, "io.stat"))
+    if lines then
+        b.io_read = 0
+        b.io_write = 0
+        for _,line in ipairs(lines) do
+            b.io_read = b.io_read + tonumber(line:match("rbytes=(%d+)") or 0)
+            b.io_write = b.io_write + tonumber(line:match("wbytes=(%d+)") or 0)
+        end
+    end
+
+    e2lib.rmdir(cg) -- ignore errors, builds may have left processes
+end
+
+--- Write the accounting of a result as e2resources table.
+-- @param resname Result name.
+-- @param path Path to the report file.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function accounting.write_report(resname, path)
+    local rc, re, a, out
+
+    a = acct(resname)
+    out = {
+        "e2resources {\n",
+        string.format("  result = %q,\n", a.name),
+        string.format("  wall = %.3f,\n", a.wall),
+        string.format("  cpu = %.3f,\n", a.cpu),
+    }
+
+    if a.build then
+        table.insert(out, "  build = {\n")
+        for _,k in ipairs({ "wall", "cpu_user", "cpu_system", "memory_peak",
+            "io_read", "io_write" }) do
+            if a.build[k] then
+                table.insert(out, string.format("    %s = %.15g,\n", k,
+                    a.build[k]))
+            end
+        end
+        table.insert(out, "  },\n")
+    end
+
+    table.insert(out, "  steps = {\n")
+    for _,s in ipairs(a.steps) do
+        table.insert(out, string.format(
+            "    { name = %q, wall = %.3f, cpu = %.3f },\n",
+            s.name, s.wall, s.cpu))
+    end
+    table.insert(out, "  },\n}\n")
+
+    rc, re = eio.file_write(path, table.concat(out))
+    if not rc then
+        return false, err.new("writing resource report failed"):cat(re)
+    end
+
+    return true
+end
+
+--- Log a table of the resources used by the results built.
+function accounting.summary()
+    local function size(n)
+        if not n then
+            return "-"
+        end
+        return string.format("%.1fM", n / 1048576)
+    end
+
+    local header = false
+    for _,resname in ipairs(_order) do
+        local b = _acct[resname].build
+        if b then
+            if not header then
+                e2lib.logf(2, "%-30s %9s %9s %9s %9s %9s", "result", "wall",
+                    "cpu", "mem peak", "io read", "io write")
+                header = true
+            end
+            e2lib.logf(2, "%-30s %8.1fs %8.1fs %9s %9s %9s", resname, b.wall,
+                b.cpu_user + b.cpu_system, size(b.memory_peak),
+                size(b.io_read), size(b.io_write))
+        end
+    end
+end
+
+return strict.lock(accounting)
+
+-- vim:sw=4:sts=4:et:
@@ -0,0 +1,182 @@
+--- Compiler cache shared by the builds of results with the same chroot groups.
+-- The cache directory is kept outside of the chroot environment and bind
+-- mounted read-write into the build directory by e2-su chroot_bind_2_3, for
+-- the build and the playground. Build scripts use it through ccache, which
+-- finds it by CCACHE_DIR. Builds sharing a cache may run concurrently, ccache
+-- locks its files itself.
+-- @module local.ccache
+
+-- Copyright (C) 2007-2016 emlix GmbH, see file AUTHORS
+--
+-- This file is part of e2factory, the emlix embedded build system.
+-- For more information see http://www.e2factory.org
+--
+-- e2factory is a registered trademark of emlix GmbH.
+--
+-- e2factory is free software: you can redistribute it and/or modify it under
+-- the terms of the GNU General Public License as published by the
+-- Free Software Foundation, either version 3 of the License, or (at your
+-- option) any later version.
+--
+-- This program is distributed in the hope that it will be useful, but WITHOUT
+-- ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+-- FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+-- more details.
+
+local ccache = {}
+package.loaded["ccache"] = ccache -- prevent module loading loop
+
+local chroot = require("chroot")
+local e2lib = require("e2lib")
+local eio = require("eio")
+local err = require("err")
+local hash = require("hash")
+local project = require("project")
+local strict = require("strict")
+
+--- Name of the cache directory in the build directory.
+ccache.dirname = "ccache"
+
+--- Name of the statistics file written by the build driver.
+ccache.statsfile = "ccache.stats"
+
+local _hits = 0
+local _misses = 0
+
+--- Check whether a result is built with the compiler cache.
+-- @param res Result object.
+-- @return True or false.
+function ccache.enabled(res)
+    return project.compiler_cache() and res:compiler_cache()
+end
+
+--- Path of the compiler cache of a result outside of the chroot. Results
+-- with the same set of chroot groups share a cache, as they use the same
+-- compilers.
+-- @param res Result object.
+-- @return Path or false on error.
+-- @return Error object on failure.
+local function store_path(res)
+    local re, hc, id, bc
+
+    hc = hash.hash_start()
+    hash.hash_append(hc, project.chroot_arch())
+    for groupname in res:chroot_list():iter() do
+        id, re = chroot.groups_byname[groupname]:chrootgroupid()
+        if not id then
+            return false, re
+        end
+        hash.hash_append(hc, id)
+    end
+
+    bc = res:build_config()
+    return e2lib.join(bc.ccache_store, hash.hash_finish(hc))
+end
+
+--- Set up the compiler cache of a result. An empty cache is created on first
+-- use, the mount point in the build directory is created as well.
+-- @param res Result object.
+-- @return Bind list line mounting the cache, false on error.
+-- @return Error object on failure.
+function ccache.checkout(res)
+    local rc, re, e, bc, store, dir
+
+    e = err.new("setting up the compiler cache failed")
+    bc = res:build_config()
+    dir = e2lib.join(bc.T, ccache.dirname)
+
+    store, re = store_path(res)
+    if not store then
+        return false, e:cat(re)
+    end
+
+    for _,d in ipairs({ store, dir }) do
+        rc, re = e2lib.mkdir_recursive(d)
+        if not rc then
+            return false, e:cat(re)
+        end
+    end
+
+    -- the destination is relative to the chroot
+    return string.format("%s\t%s\trw\n", store,
+        string.sub(e2lib.join(bc.Tc, ccache.dirname), 2))
+end
+
+--- Collect the hit and miss statistics of the build of a result.
+-- @param res Result object.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function ccache.stats(res)
+    local rc, re, e, bc, stats, hits, misses, file, line
+
+    e = err.new("reading the compiler cache statistics failed")
+    bc = res:build_config()
+
+    stats = e2lib.join(bc.T, ccache.statsfile)
+    if not e2lib.isfile(stats) then
+        return true
+    end
+
+    file, re = eio.fopen(stats, "r")
+    if not file then
+        return false, e:cat(re)
+    end
+
+    -- ccache --print-stats: one "key<TAB>value" per line
+    hits = 0
+    misses = 0
+    while true do
+        line, re = eio.readline(file)
+        if not line then
+            eio.fclose(file)
+            return false, e:cat(re)
+        elseif line == "" then
+            break
+        end
+
+        local key, val = line:match("^([%w_]+)\t(%d+)")
+        if key == "direct_cache_hit" or
+            key == "preprocessed_cache_hit" then
+            hits = hits + tonumber(val)
+        elseif key == "cache_miss" then
+            misses = misses + tonumber(val)
+        end
+    end
+
+    rc, re = eio.fclose(file)
+    if not rc then
+        return false, e:cat(re)
+    end
+
+    _hits = _hits + hits
+    _misses = _misses + misses
+    e2lib.logf(3, "compiler cache: %s: %d hits, %d misses",
+        res:get_name(), hits, misses)
+
+    return true
+end
+
+--- Add the compiler cache variables to an environment.
+-- @param res Result object.
+-- @param env Environment object.
+function ccache.env(res, env)
+    local bc = res:build_config()
+
+    env:set("CCACHE_DIR", e2lib.join(bc.Tc, ccache.dirname))
+    env:set("CCACHE_BASEDIR", e2lib.join(bc.Tc, "build"))
+    if project.compiler_cache_max_size() then
+        env:set("CCACHE_MAXSIZE", project.compiler_cache_max_size())
+    end
+end
+
+--- Log the compiler cache hits and misses of all builds.
+function ccache.report()
+    if _hits + _misses > 0 then
+        e2lib.logf(2, "compiler cache: %d hits, %d misses (%d%%)", _hits,
+            _misses, math.floor(_hits * 100 / (_hits + _misses)))
+    end
+end
+
+return strict.lock(ccache)
+
+-- vim:sw=4:sts=4:et:
@@ -0,0 +1,365 @@
+--- Compiled cache of result and source configurations. Stores the tables
+-- passed to e2result and e2source by every config file, indexed by path and
+-- validated by the file status, as precompiled Lua chunk. Loading one chunk
+-- replaces loading and running thousands of config files on startup.
+-- The cache is dropped as a whole when the e2factory version or the project
+-- environment changes, as config files may refer to it.
+-- @module local.configcache
+
+-- Copyright (C) 2007-2016 emlix GmbH, see file AUTHORS
+--
+-- This file is part of e2factory, the emlix embedded build system.
+-- For more information see http://www.e2factory.org
+--
+-- e2factory is a registered trademark of emlix GmbH.
+--
+-- e2factory is free software: you can redistribute it and/or modify it under
+-- the terms of the GNU General Public License as published by the
+-- Free Software Foundation, either version 3 of the License, or (at your
+-- option) any later version.
+--
+-- This program is distributed in the hope that it will be useful, but WITHOUT
+-- ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+-- FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+-- more details.
+
+local configcache = {}
+package.loaded["configcache"] = configcache
+
+local buildconfig = require("buildconfig")
+local e2lib = require("e2lib")
+local e2tool = require("e2tool")
+local eio = require("eio")
+local hash = require("hash")
+local projenv = require("projenv")
+local strict = require("strict")
+
+--- Path of the cache file relative to the project root.
+local CACHEFILE = ".e2/configcache"
+
+--- File status fields an entry is validated against.
+local STATFIELDS = { "mtime", "mtime_nsec", "ctime", "ctime_nsec", "size",
+    "dev", "ino" }
+
+--- Cache entry table.
+-- @table entry
+-- @field mtime ...and the other STATFIELDS of the config file.
+-- @field calls Vector of the tables passed to the collector function.
+-- @field source Serialized entry, only for entries created in this run.
+
+local _entries = false  -- entries loaded from the cache file, by path
+local _used = {}        -- entries to store, by path
+local _envdigest = false
+local _hits = 0
+local _misses = 0
+local _stale = false    -- entries were replaced or created in this run
+
+local lua_keywords = {}
+for _,kw in ipairs({ "and", "break", "do", "else", "elseif", "end", "false",
+    "for", "function", "if", "in", "local", "nil", "not", "or", "repeat",
+    "return", "then", "true", "until", "while" }) do
+    lua_keywords[kw] = true
+end
+
+--- Serialize a value as Lua expression. Only strings, finite numbers,
+-- booleans and tables without cycles can be serialized. Table keys are
+-- sorted, equal tables give equal output.
+-- @param v Value.
+-- @param out Vector of strings the expression is appended to.
+-- @param seen Tables on the current path. Only for recursion.
+-- @return True on success, false if the value can not be serialized.
+local function serialize(v, out, seen)
+    local t = type(v)
+
+    if t == "string" then
+        table.insert(out, string.format("%q", v))
+    elseif t == "number" then
+        if v ~= v or v == math.huge or v == -math.huge then
+            return false
+        end
+        table.insert(out, string.format("%.17g", v))
+    elseif t == "boolean" then
+        table.insert(out, tostring(v))
+    elseif t == "table" then
+        local keys
+
+        seen = seen or {}
+        if seen[v] then
+            return false
+        end
+        seen[v] = true
+
+        keys = {}
+        for k,_ in pairs(v) do
+            local kt = type(k)
+            if kt ~= "string" and kt ~= "number" and kt ~= "boolean" then
+                return false
+            end
+            table.insert(keys, k)
+        end
+        table.sort(keys, function(a, b)
+            if type(a) ~= type(b) then
+                return type(a) < type(b)
+            elseif type(a) == "boolean" then
+                return not a and b
+            end
+            return a < b
+        end)
+
+        table.insert(out, "{")
+        for _,k in ipairs(keys) do
+            if type(k) == "string" and k:match("^[%a_][%w_]*$")
+                and not lua_keywords[k] then
+                table.insert(out, k)
+            else
+                table.insert(out, "[")
+                if not serialize(k, out, seen) then
+                    return false
+                end
+                table.insert(out, "]")
+            end
+            table.insert(out, "=")
+            if not serialize(v[k], out, seen) then
+                return false
+            end
+            table.insert(out, ",")
+        end
+        table.insert(out, "}")
+
+        seen[v] = nil
+    else
+        return false
+    end
+
+    return true
+end
+
+--- Copy a table loaded from the cache, callers may modify their copy.
+-- @param t Table.
+-- @return Copy of the table.
+local function deepcopy(t)
+    local c = {}
+
+    for k,v in pairs(t) do
+        if type(v) == "table" then
+            c[k] = deepcopy(v)
+        else
+            c[k] = v
+        end
+    end
+
+    return c
+end
+
+--- Digest of the project environment that config files can refer to.
+-- @return Digest string.
+local function envdigest()
+    local out
+
+    if not _envdigest then
+        local hc = hash.hash_start()
+
+        out = {}
+        -- environments hold strings only
+        assert(serialize(projenv.safe_global_res_env_table(), out))
+        hash.hash_append(hc, buildconfig.VERSIONSTRING)
+        hash.hash_append(hc, table.concat(out))
+        _envdigest = hash.hash_finish(hc)
+    end
+
+    return _envdigest
+end
+
+--- Load the cache file. Done automatically on first use, also installs a
+-- cleanup callback to store the cache.
+local function load_cache()
+    local rc, chunk, msg, ctab
+
+    _entries = {}
+
+    e2lib.register_cleanup("configcache:store", configcache.store)
+
+    chunk, msg = loadfile(e2lib.join(e2tool.root(), CACHEFILE))
+    if not chunk then
+        e2lib.logf(3, "could not load config cache: %s", msg)
+        return
+    end
+
+    -- set empty environment for this chunk
+    setfenv(chunk, {})
+    rc, ctab = pcall(chunk)
+    if not rc or type(ctab) ~= "table" or type(ctab.files) ~= "table" then
+        e2lib.logf(3, "ignoring malformed config cache")
+        return
+    end
+
+    if ctab.env ~= envdigest() then
+        e2lib.logf(3, "config cache is outdated")
+        return
+    end
+
+    for path,entry in pairs(ctab.files) do
+        if type(path) == "string" and type(entry) == "table"
+            and type(entry.calls) == "table" then
+            _entries[path] = entry
+        end
+    end
+end
+
+--- Look up the entry of a config file.
+-- @param path Path to the config file.
+-- @param sb Dirent table of the config file.
+-- @return Entry or false if there is no current entry.
+local function lookup(path, sb)
+    local entry = _entries[path]
+
+    if not entry then
+        return false
+    end
+
+    for _,f in ipairs(STATFIELDS) do
+        if entry[f] ~= sb[f] then
+            return false
+        end
+    end
+
+    return entry
+end
+
+--- Execute a config file like e2lib.dofile2(), unless the calls of the
+-- collector function made by the file are cached. In that case the collector
+-- function is called with copies of the cached tables instead. Config files
+-- are expected to interact with the environment only through the
+-- collector function.
+-- @param path Path to the config file.
+-- @param gtable Environment table of the config file, see e2lib.dofile2().
+-- @param collector Name of the collector function in gtable, e.g. "e2result".
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function configcache.dofile2(path, gtable, collector)
+    assertIsStringN(path)
+    assertIsTable(gtable)
+    assertIsFunction(gtable[collector])
+
+    local rc, re, sb, entry, calls, func, out
+
+    if not _entries then
+        load_cache()
+    end
+
+    sb = e2lib.stat(path)
+    if not sb then
+        -- let dofile2 report the error
+        return e2lib.dofile2(path, gtable)
+    end
+
+    entry = lookup(path, sb)
+    if entry then
+        _hits = _hits + 1
+        _used[path] = entry
+        for _,data in ipairs(entry.calls) do
+            gtable[collector](deepcopy(data))
+        end
+        return true
+    end
+
+    _misses = _misses + 1
+
+    calls = {}
+    func = gtable[collector]
+    gtable[collector] = function(data)
+        table.insert(calls, data)
+        return func(data)
+    end
+
+    rc, re = e2lib.dofile2(path, gtable)
+    if not rc then
+        return false, re
+    end
+
+    -- serialize before the caller modifies the tables
+    out = { "{calls={" }
+    for _,data in ipairs(calls) do
+        if not serialize(data, out) then
+            e2lib.logf(4, "config cache: can not cache %s", path)
+            return true
+        end
+        table.insert(out, ",")
+    end
+    table.insert(out, "},")
+    for _,f in ipairs(STATFIELDS) do
+        table.insert(out, string.format("%s=%.17g,", f, sb[f]))
+    end
+    table.insert(out, "}")
+
+    entry = { source = table.concat(out) }
+    for _,f in ipairs(STATFIELDS) do
+        entry[f] = sb[f]
+    end
+    _used[path] = entry
+    _stale = true
+
+    return true
+end
+
+--- Store the cache file if entries were created in this run. Entries of
+-- config files that were not loaded are kept, tools loading results on
+-- demand only see some, unless the config file was removed.
+-- Called by cleanup handler.
+function configcache.store()
+    local rc, re, out, chunk, msg, root, path
+
+    if not _entries then
+        return
+    end
+
+    e2lib.logf(3, "config cache: %d hits, %d misses", _hits, _misses)
+
+    if not _stale then
+        return
+    end
+
+    for path,entry in pairs(_entries) do
+        if not _used[path] and e2lib.exists(path) then
+            _used[path] = entry
+        end
+    end
+
+    root = e2lib.locate_project_root()
+    if not root then
+        return
+    end
+
+    out = { string.format("return {env=%q,files={\n", envdigest()) }
+    for path,entry in pairs(_used) do
+        table.insert(out, string.format("[%q]=", path))
+        if entry.source then
+            table.insert(out, entry.source)
+        else
+            -- entry loaded from the cache, its tables are unmodified
+            assert(serialize(entry, out))
+        end
+        table.insert(out, ",\n")
+    end
+    table.insert(out, "}}\n")
+
+    -- precompiled chunks load several times faster than source
+    chunk, msg = loadstring(table.concat(out), "configcache")
+    if not chunk then
+        e2lib.logf(3, "could not compile config cache: %s", msg)
+        return
+    end
+
+    path = e2lib.join(root, CACHEFILE)
+    rc, re = eio.file_write(path .. ".tmp", string.dump(chunk))
+    if rc then
+        rc, re = e2lib.rename(path .. ".tmp", path)
+    end
+    if not rc then
+        e2lib.logf(3, "could not store config cache: %s", re:tostring())
+    end
+end
+
+return strict.lock(configcache)
+
+-- vim:sw=4:sts=4:et:
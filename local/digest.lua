@@ -30,6 +30,7 @@ local err = require("err")
 local lsha = require("lsha")
 local strict = require("strict")
 local trace = require("trace")
+local traceevent = require("traceevent")
 local cscache = require("cscache")
 
 --- Digest table.
@@ -466,16 +467,17 @@ function digest.checksum(dt, directory)
     assert(type(dt) == "table")
     assert(type(directory) == "string" or directory == false)
 
-    local e = err.new("checksuming failed")
     local rc, re
+    local tev = traceevent.begin()
 
     for pos, entry in ipairs(dt) do
         rc, re = compute_checksum_entry(pos, entry, directory, false)
         if not rc then
-            return false, e:cat(re)
+            return false, err.new("checksuming failed"):cat(re)
         end
     end
 
+    traceevent.complete(tev, "checksum", "checksum", { files = #dt })
     return true
 end
 
@@ -491,16 +493,17 @@ function digest.verify(dt, directory)
     assert(type(dt) == "table")
     assert(type(directory) == "string" or directory == false)
 
-    local e = err.new("checksum verification failed")
     local rc, re
+    local tev = traceevent.begin()
 
     for pos, entry in ipairs(dt) do
         rc, re = compute_checksum_entry(pos, entry, directory, true)
         if not rc then
-            return false, e:cat(re)
+            return false, err.new("checksum verification failed"):cat(re)
         end
     end
 
+    traceevent.complete(tev, "verify", "checksum", { files = #dt })
     return true
 end
 
@@ -18,16 +18,22 @@
 -- FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
 -- more details.
 
+local accounting = require("accounting")
 local cache = require("cache")
+local ccache = require("ccache")
 local console = require("console")
 local e2build = require("e2build")
 local e2lib = require("e2lib")
 local e2option = require("e2option")
 local e2tool = require("e2tool")
 local err = require("err")
+local jobserver = require("jobserver")
 local policy = require("policy")
 local project = require("project")
 local result = require("result")
+local srccache = require("srccache")
+local traceevent = require("traceevent")
+local writeback = require("writeback")
 
 local function e2_build(arg)
     local e2project
@@ -83,7 +89,15 @@ local function e2_build(arg)
     e2option.flag("force-rebuild", "force rebuilding even if a result exists")
     e2option.flag("playground", "prepare environment but do not build")
     e2option.flag("keep", "do not remove chroot environment after build")
+    e2option.flag("resume",
+        "continue failed builds in their chroot environments")
     e2option.flag("buildid", "display buildids and exit")
+    e2option.flag("wait-writeback",
+        "wait for queued uploads to finish before exiting")
+    e2option.option("jobs", "number of parallel make jobs of all builds",
+        nil, nil, "N")
+    e2option.option("trace", "write a trace of the build steps to a file",
+        nil, nil, "FILE")
 
     local opts, arguments = e2option.parse(arg)
     if not opts then
@@ -100,11 +114,48 @@ local function e2_build(arg)
         error(re)
     end
 
-    rc, re = e2project:load_project()
+    if opts.trace then
+        rc, re = traceevent.open(opts.trace)
+        if not rc then
+            error(re)
+        end
+    end
+
+    -- without --all, only the results to build and their dependencies
+    rc, re = e2project:load_project(false, not opts["all"])
     if not rc then
         error(re)
     end
 
+    local config, re = e2lib.get_global_config()
+    if not config then
+        error(re)
+    end
+
+    local jobs = e2lib.globals.build_jobs
+    if opts.jobs then
+        jobs = tonumber(opts.jobs)
+        if not jobs then
+            error(err.new("--jobs expects a number: %q", opts.jobs))
+        end
+    end
+
+    if jobs > 0 then
+        rc, re = jobserver.start(jobs)
+        if not rc then
+            error(re)
+        end
+    end
+
+    if config.cache.writeback_jobs and config.cache.writeback_jobs > 0 then
+        rc, re = writeback.enable(cache.cache(),
+            e2lib.join(e2tool.root(), ".e2/writeback"),
+            config.cache.writeback_jobs)
+        if not rc then
+            error(re)
+        end
+    end
+
     if opts["all"] and (#selected_results > 0 or specific_result_count > 0) then
         error(err.new("--all with additional results does not make sense"))
     elseif opts["all"] then
@@ -180,6 +231,7 @@ local function e2_build(arg)
     end
     local force_rebuild = opts["force-rebuild"]
     local keep_chroot = opts["keep"]
+    local resume = opts["resume"] or false
 
     -- processing options is over, lets sort this out
 
@@ -228,6 +280,7 @@ local function e2_build(arg)
     -- first, standard build mode and settings for all
     for _,resultname in ipairs(ordered_results) do
         set:add(resultname, "build", build_mode)
+        set:result_build_set(resultname):build_settings():resume(resume)
    end
 
     -- selected results
@@ -286,6 +339,17 @@ local function e2_build(arg)
             error(re)
         end
     end
+
+    accounting.summary()
+    ccache.report()
+    srccache.report()
+
+    if opts["wait-writeback"] then
+        rc, re = writeback.wait()
+        if not rc then
+            error(re)
+        end
+    end
 end
 
 local pc, re = e2lib.trycall(e2_build, arg)
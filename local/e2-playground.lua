@@ -56,7 +56,7 @@ local function e2_playground(arg)
         error(re)
     end
 
-    rc, re = e2project:load_project()
+    rc, re = e2project:load_project(false, true)
     if not rc then
         error(re)
     end
@@ -21,7 +21,9 @@
 local e2build = {}
 package.loaded["e2build"] = e2build
 
+local accounting = require("accounting")
 local cache = require("cache")
+local ccache = require("ccache")
 local chroot = require("chroot")
 local class = require("class")
 local digest = require("digest")
@@ -30,11 +32,483 @@ local e2tool = require("e2tool")
 local eio = require("eio")
 local environment = require("environment")
 local err = require("err")
+local errno = require("errno")
+local hash = require("hash")
+local jobserver = require("jobserver")
+local outputid = require("outputid")
 local project = require("project")
 local result = require("result")
 local source = require("source")
+local srccache = require("srccache")
 local strict = require("strict")
+local tmpfs = require("tmpfs")
 local tools = require("tools")
+local traceevent = require("traceevent")
+local writeback = require("writeback")
+
+--- Result archive formats known when looking up a stored result. The
+-- project result_format is always tried first. The "objects" format is a
+-- manifest of files kept in the content addressed object store.
+local result_formats = { "tar", "tar.zst", "objects" }
+
+--- Number of result files handed to one chown call when storing a result.
+-- e2-su takes at most 128 arguments, six of them are taken by
+-- "e2-su chroot_2_3 <base> chown -- <owner>".
+local CHOWN_FILES = 120
+
+--- Whether e2-su can bind mount into the chroot, checked once per run.
+local _bind_supported = nil
+
+--- Check whether e2-su can bind mount dependencies and the compiler cache
+-- into the chroot. Needs mount namespaces and an e2-su knowing
+-- chroot_bind_2_3.
+-- @param bc Build config of a result with an existing chroot.
+-- @return True or false.
+local function bind_supported(bc)
+    local rc
+
+    if _bind_supported == nil then
+        e2tool.set_umask()
+        rc = e2lib.e2_su_2_2({"bind_check_2_3", bc.base})
+        e2tool.reset_umask()
+        _bind_supported = rc and true or false
+        if not rc then
+            e2lib.warnf("WOTHER", "e2-su can not bind mount, dependencies "..
+                "are unpacked into the chroot and the compiler cache is "..
+                "not used")
+        end
+    end
+
+    return _bind_supported
+end
+
+--- Get the e2-su command entering the chroot of a result, mounting its
+-- read-only dependencies and compiler cache if it has any.
+-- @param bc Build config.
+-- @return e2-su command name.
+local function chroot_command(bc)
+    if e2lib.exists(bc.binds_file) then
+        return "chroot_bind_2_3"
+    end
+    return "chroot_2_3"
+end
+
+--- Add lines to the bind list of a chroot, see chroot_bind_2_3 in e2-su.
+-- @param bc Build config.
+-- @param binds Table of lines.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+local function add_binds(bc, binds)
+    local rc, re, file
+
+    file, re = eio.fopen(bc.binds_file, "a")
+    if not file then
+        return false, re
+    end
+
+    rc, re = eio.fwrite(file, table.concat(binds))
+    eio.fclose(file)
+    if not rc then
+        return false, re
+    end
+
+    return true
+end
+
+--- Check whether a result is built with the compiler cache. The cache is bind
+-- mounted into the chroot, without bind mounts it is not used.
+-- @param res Result object with an existing chroot.
+-- @return True or false.
+local function compiler_cache(res)
+    return ccache.enabled(res) and bind_supported(res:build_config())
+end
+
+--- Get the location of a file in the content addressed object store.
+-- @param location Result storage location on the server.
+-- @param checksum SHA1 checksum of the file.
+-- @return Location of the object on the server.
+local function result_object_location(location, checksum)
+    assert(#checksum == digest.SHA1_LEN)
+    checksum = string.lower(checksum)
+    return e2lib.join(location, ".objects", string.sub(checksum, 1, 2),
+        checksum)
+end
+
+--- Locate the stored archive of a result. Looks for the archive in the
+-- project result_format first, then accepts any other known format,
+-- including the legacy uncompressed result.tar.
+-- @param server Server name.
+-- @param resultdir Location of the result directory on the server,
+--                  that is <location>/<result>/<buildid>.
+-- @return Location of the archive, or false if none was found or on error.
+-- @return Format of the archive, one of result_formats. Error object on
+--         failure, nil if no archive was found.
+local function result_archive_lookup(server, resultdir)
+    local rc, re, formats, location
+
+    formats = { project.result_format() }
+    for _,fmt in ipairs(result_formats) do
+        if fmt ~= formats[1] then
+            table.insert(formats, fmt)
+        end
+    end
+
+    for _,fmt in ipairs(formats) do
+        location = e2lib.join(resultdir, "result." .. fmt)
+        rc, re = cache.file_exists(cache.cache(), server, location)
+        if re then
+            return false, re
+        end
+
+        if rc then
+            return location, fmt
+        end
+    end
+
+    return false
+end
+
+--- Assemble a result stored in the object store from its manifest. Only
+-- objects missing in the cache are transferred. The objects are linked into
+-- a tree of symlinks named like the result files, which is copied into place
+-- by a single cp, as reflinks where the file system supports it. Hardlinks
+-- would let the build change the objects, which are named by their checksum.
+-- @param server Server name.
+-- @param location Result storage location on the server.
+-- @param manifest Path to the fetched manifest (checksums) file.
+-- @param resdir Existing, empty directory to assemble the result in.
+-- @param e Error object of the caller.
+-- @return Digest table of the result checksums, or false on error.
+-- @return Error object on failure.
+local function result_unpack_objects(server, location, manifest, resdir, e)
+    local rc, re, dt, path, dst, linkdir
+
+    rc, re = e2lib.cp(manifest, e2lib.join(resdir, "checksums"))
+    if not rc then
+        return false, e:cat(re)
+    end
+
+    dt, re = digest.parse(e2lib.join(resdir, "checksums"))
+    if not dt then
+        return false, e:cat(re)
+    end
+
+    linkdir, re = e2lib.mktempdir()
+    if not linkdir then
+        return false, e:cat(re)
+    end
+
+    for _,entry in ipairs(dt) do
+        if entry.digest ~= digest.SHA1 then
+            e2lib.rmtempdir(linkdir)
+            return false, e:append("manifest entry without SHA1 checksum: %s",
+                entry.name)
+        end
+
+        path, re = cache.fetch_file_path(cache.cache(), server,
+            result_object_location(location, entry.checksum))
+        if not path then
+            e2lib.rmtempdir(linkdir)
+            return false, e:cat(re)
+        end
+
+        dst = e2lib.join(linkdir, entry.name)
+        rc, re = e2lib.mkdir_recursive(e2lib.dirname(dst))
+        if rc then
+            rc, re = e2lib.symlink(path, dst)
+        end
+        if not rc then
+            e2lib.rmtempdir(linkdir)
+            return false, e:cat(re)
+        end
+    end
+
+    rc, re = e2lib.call_tool_argv("cp", { "-R", "-L", "--reflink=auto",
+        linkdir .. "/.", resdir })
+    e2lib.rmtempdir(linkdir)
+    if not rc then
+        return false, e:cat(re)
+    end
+
+    rc, re = digest.verify(dt, resdir)
+    if not rc then
+        return false, e:cat(re)
+    end
+
+    return dt
+end
+
+--- Store the files of a result in the content addressed object store.
+-- The objects are linked into a temporary .objects tree and uploaded in a
+-- single transfer per hop, skipping objects already present on the server
+-- instead of asking for each one. The manifest is pushed last, its presence
+-- marks a complete result.
+-- @param server Server name.
+-- @param location Result storage location on the server.
+-- @param resultdir Location of the result directory on the server.
+-- @param resdir Directory containing the result structure.
+-- @param dt Digest table of the result files.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+local function result_store_objects(server, location, resultdir, resdir, dt)
+    local rc, re, objdir, src, dst, staged
+    local cache_flags = {
+        try_hardlink = true,
+    }
+
+    objdir, re = e2lib.mktempdir()
+    if not objdir then
+        return false, re
+    end
+
+    staged = {}
+    for _,entry in ipairs(dt) do
+        assert(entry.digest == digest.SHA1)
+        if not staged[entry.checksum] then
+            staged[entry.checksum] = true
+            src = e2lib.join(resdir, entry.name)
+            dst = result_object_location(objdir, entry.checksum)
+
+            rc, re = e2lib.mkdir_recursive(e2lib.dirname(dst))
+            if rc and not e2lib.hardlink(src, dst) then
+                rc, re = e2lib.cp(src, dst)
+            end
+            if not rc then
+                e2lib.rmtempdir(objdir)
+                return false, re
+            end
+        end
+    end
+
+    rc, re = cache.push_directory(cache.cache(), e2lib.join(objdir, ".objects"),
+        server, e2lib.join(location, ".objects"), { ignore_existing = true })
+    e2lib.rmtempdir(objdir)
+    if not rc then
+        return false, re
+    end
+
+    e2lib.logf(3, "stored %d objects for %s", digest.count(dt), resultdir)
+
+    rc, re = cache.push_file(cache.cache(), e2lib.join(resdir, "build.log.gz"),
+        server, e2lib.join(resultdir, "build.log.gz"), cache_flags)
+    if not rc then
+        return false, re
+    end
+
+    -- written back after the objects, also with the writeback queue
+    rc, re = cache.push_file(cache.cache(), e2lib.join(resdir, "checksums"),
+        server, e2lib.join(resultdir, "result.objects"),
+        { try_hardlink = true, barrier = true })
+    if not rc then
+        return false, re
+    end
+
+    return true
+end
+
+--- Fetch a stored result and unpack it into resdir. A delta result is
+-- reassembled from its base result. The unpacked result is verified against
+-- its checksums file.
+-- @param server Server name.
+-- @param location Result storage location on the server.
+-- @param resultname Result name.
+-- @param buildid BuildID of the result.
+-- @param resdir Existing, empty directory to unpack the result into.
+-- @param nodelta Fail if the result is stored as a delta.
+-- @return Digest table of the result checksums, or false on error.
+-- @return BuildID of the full result the files are based on, that is the
+--         delta base or the buildid argument. Error object on failure.
+local function result_unpack(server, location, resultname, buildid, resdir,
+    nodelta)
+    local rc, re, e, archive, tartype, path, argv, dt
+    local basefile, basebid, tmpdir, basedir, src, dst
+
+    e = err.new("unpacking result %s [%s] failed", resultname, buildid)
+
+    archive, tartype = result_archive_lookup(server,
+        e2lib.join(location, resultname, buildid))
+    if not archive then
+        re = tartype or err.new("result archive not found on %s:%s",
+            server, e2lib.join(location, resultname, buildid))
+        return false, e:cat(re)
+    end
+
+    path, re = cache.fetch_file_path(cache.cache(), server, archive)
+    if not path then
+        return false, e:cat(re)
+    end
+
+    if tartype == "objects" then
+        dt, re = result_unpack_objects(server, location, path, resdir, e)
+        if not dt then
+            return false, re
+        end
+        return dt, buildid
+    end
+
+    argv, re = e2lib.tar_compress_flags(tartype)
+    if not argv then
+        return false, e:cat(re)
+    end
+
+    table.insert(argv, "-xf")
+    table.insert(argv, path)
+    table.insert(argv, "-C")
+    table.insert(argv, resdir)
+    rc, re = e2lib.tar(argv)
+    if not rc then
+        return false, e:cat(re)
+    end
+
+    dt, re = digest.parse(e2lib.join(resdir, "checksums"))
+    if not dt then
+        return false, e:cat(re)
+    end
+
+    -- a delta result only contains the files changed against its base
+    basefile = e2lib.join(resdir, "base")
+    basebid = buildid
+    if e2lib.exists(basefile) then
+        if nodelta then
+            return false, e:append("delta result can not be used as base")
+        end
+
+        basebid, re = eio.file_read_line(basefile)
+        if not basebid then
+            return false, e:cat(re)
+        end
+
+        tmpdir, re = e2lib.mktempdir()
+        if not tmpdir then
+            return false, e:cat(re)
+        end
+
+        basedir = e2lib.join(tmpdir, "result")
+        rc, re = e2lib.mkdir(basedir)
+        if not rc then
+            return false, e:cat(re)
+        end
+
+        rc, re = result_unpack(server, location, resultname, basebid,
+            basedir, true)
+        if not rc then
+            return false, e:cat(re)
+        end
+
+        for _,entry in ipairs(dt) do
+            dst = e2lib.join(resdir, entry.name)
+            if not e2lib.exists(dst) then
+                src = e2lib.join(basedir, entry.name)
+                rc, re = e2lib.mkdir_recursive(e2lib.dirname(dst))
+                if not rc then
+                    return false, e:cat(re)
+                end
+
+                rc, re = e2lib.rename(src, dst)
+                if not rc then
+                    return false, e:cat(re)
+                end
+            end
+        end
+
+        e2lib.rmtempdir(tmpdir)
+
+        rc, re = e2lib.unlink(basefile)
+        if not rc then
+            return false, e:cat(re)
+        end
+    end
+
+    rc, re = digest.verify(dt, resdir)
+    if not rc then
+        e:append("checksum mismatch in result: %s", resultname)
+        return false, e:cat(re)
+    end
+
+    return dt, basebid
+end
+
+--- Get the BuildID of the full result a stored result is based on, without
+-- fetching its archive. A delta result is stored with a "base" file next to
+-- its archive.
+-- @param server Server name.
+-- @param location Result storage location on the server.
+-- @param resultname Result name.
+-- @param buildid BuildID of the result.
+-- @return BuildID of the delta base, or the buildid argument if the result
+--         is stored in full. False on error.
+-- @return Error object on failure.
+local function result_base(server, location, resultname, buildid)
+    local rc, re, basefile, path, basebid
+
+    basefile = e2lib.join(location, resultname, buildid, "base")
+    rc, re = cache.file_exists(cache.cache(), server, basefile)
+    if re then
+        return false, re
+    end
+
+    if not rc then
+        return buildid
+    end
+
+    path, re = cache.fetch_file_path(cache.cache(), server, basefile)
+    if not path then
+        return false, re
+    end
+
+    basebid, re = eio.file_read_line(path)
+    if not basebid then
+        return false, re
+    end
+
+    if #basebid ~= digest.SHA1_LEN then
+        return false, err.new("malformed delta base in %s:%s", server,
+            basefile)
+    end
+
+    return basebid
+end
+
+--- Build steps run again when resuming a build. They keep no state in the
+-- chroot and are not recorded.
+local RESUME_RERUN = {
+    result_available = true, chroot_lock = true, chroot_unlock = true,
+}
+
+--- Read the record of completed build steps kept with a chroot.
+-- @param bc Build config.
+-- @return BuildID the chroot was set up for, or false if there is no
+--         record.
+-- @return Table of completed step names.
+local function read_steps(bc)
+    local file, line, buildid, steps
+
+    if not e2lib.exists(bc.chroot_marker) then
+        return false
+    end
+
+    file = eio.fopen(bc.steps_file, "r")
+    if not file then
+        return false
+    end
+
+    steps = {}
+    while true do
+        line = eio.readline(file)
+        if not line or line == "" then
+            break
+        end
+        line = string.gsub(line, "\n$", "")
+        if not buildid then
+            buildid = line
+        else
+            steps[line] = true
+        end
+    end
+    eio.fclose(file)
+
+    return buildid or false, steps
+end
 
 --- Build process class. Every result is given to an instance of this class.
 -- @type build_process_class
@@ -61,6 +535,7 @@ function e2build.build_process_class:initialize()
     self:add_step("build", "fix_permissions", self._fix_permissions)
     self:add_step("build", "build_playground", self._build_playground)
     self:add_step("build", "runbuild", self._runbuild)
+    self:add_step("build", "compiler_cache_stats", self._compiler_cache_stats)
     self:add_step("build", "store_result", self._store_result)
     self:add_step("build", "linklast", self._linklast)
     self:add_step("build", "chroot_cleanup", self._chroot_cleanup)
@@ -78,6 +553,17 @@ end
 function e2build.build_process_class:build(res, rbs)
     assert(res:isInstanceOf(result.basic_result))
 
+    local skip, record, re
+
+    if rbs:process_mode() == "build" then
+        skip, re = self:_resume_steps(res, rbs)
+        if re then
+            return false, re
+        end
+        -- a resumed build adds to the record, others start a new one
+        record = skip and "a" or "w"
+    end
+
     if rbs:message() then
         e2lib.log(2, rbs:message())
     end
@@ -86,34 +572,86 @@ function e2build.build_process_class:build(res, rbs)
     end
 
     e2lib.logf(3, "building result: %s", res:get_name())
+    local tev = traceevent.begin()
+
+    -- the resource report is kept from the last run of the build script
+    local built = false
+    local function report()
+        traceevent.complete(tev, res:get_name(), "result")
+        if not built then
+            return
+        end
+        local rc, re = accounting.write_report(res:get_name(),
+            res:build_config().resourcelog)
+        if not rc then
+            e2lib.warnf("WOTHER", "%s", re:tostring())
+        end
+    end
 
-    for step in self:_next_step(rbs:process_mode()) do
+    for step in self:_next_step(rbs:process_mode(), skip) do
         local rc, re
-        local t1, t2, deltat
+        local t1, t2, deltat, ru1, ru2
 
         rbs:message(false) -- reset message before next step
 
         e2lib.logf(4, "e2build step=%s res=%s", step.name, res:get_name())
-        t1 = os.time()
+        ru1, re = e2lib.getrusage_children()
+        if not ru1 then
+            return false, re
+        end
+        t1 = e2lib.monotime()
         rc, re = step.func(self, res, rbs)
-        t2 = os.time()
+        t2 = e2lib.monotime()
+        if step.name == "runbuild" then
+            built = true
+        end
+        traceevent.complete(t1, step.name, "step",
+            { result = res:get_name(), ok = tostring(rc and true) })
+        ru2 = e2lib.getrusage_children() or ru1
 
-        deltat = os.difftime(t2, t1)
+        deltat = t2 - t1
         e2lib.logf(3, "timing: step: %s [%s] %d", step.name, res:get_name(), deltat)
+        accounting.step(res:get_name(), step.name, deltat,
+            ru2.utime + ru2.stime - ru1.utime - ru1.stime)
 
         if not rc then
+            report()
+            -- the chroot is kept for the playground and --resume
+            if tmpfs.enabled(res) and tmpfs.mounted(res) then
+                e2lib.warnf("WOTHER", "the tmpfs chroot of %s stays mounted "..
+                    "until the result is built again", res:get_name())
+            end
             -- do not insert an error message from this layer.
             return false, re
         end
 
+        -- steps before the chroot is set up and after it is removed are
+        -- not recorded
+        if record and not RESUME_RERUN[step.name] and
+            e2lib.exists(res:build_config().chroot_marker) then
+            rc, re = self:_record_step(res, rbs, step.name, record)
+            if not rc then
+                return false, re
+            end
+            record = "a"
+        end
+
+        -- start queued uploads in the background
+        rc, re = writeback.poll()
+        if not rc then
+            return false, re
+        end
+
         if rbs:message() then
             e2lib.log(2, rbs:message())
         end
         if rbs:skip() then
+            report()
             return true
         end
     end
 
+    report()
     return true
 end
 
@@ -209,18 +747,98 @@ end
 
 --- Iterator returns the next step in the chosen build process mode
 -- @param process_mode Build process mode
+-- @param skip Optional table of step names to leave out.
 -- @return Iterator function
-function e2build.build_process_class:_next_step(process_mode)
+function e2build.build_process_class:_next_step(process_mode, skip)
     assertIsStringN(process_mode)
     assertIsTable(self._modes[process_mode])
     local i = 0
 
     return function()
         i = i + 1
+        while skip and self._modes[process_mode][i] and
+            skip[self._modes[process_mode][i].name] do
+            e2lib.logf(3, "resuming: skipping step %s",
+                self._modes[process_mode][i].name)
+            i = i + 1
+        end
         return self._modes[process_mode][i]
     end
 end
 
+--- Get the steps to skip when resuming a build in a kept chroot. The chroot
+-- must have been set up for the current BuildID of the result.
+-- @param res Result object
+-- @param rbs Result build set
+-- @return Table of step names, or false if the build is not resumed.
+-- @return Error object on failure.
+function e2build.build_process_class:_resume_steps(res, rbs)
+    local buildid, re, recorded, steps
+
+    if not rbs:build_settings():resume() then
+        return false
+    end
+
+    buildid, re = res:buildid(rbs)
+    if not buildid then
+        return false, re
+    end
+
+    recorded, steps = read_steps(res:build_config())
+    if not recorded then
+        e2lib.logf(2, "no chroot to resume for %s", res:get_name())
+        return false
+    elseif recorded ~= buildid then
+        e2lib.logf(2, "not resuming %s, the chroot was set up for "..
+            "another BuildID", res:get_name())
+        return false
+    end
+
+    e2lib.logf(2, "resuming %s in the kept chroot", res:get_name())
+
+    -- the chroot is the one to resume in
+    steps["chroot_cleanup_if_exists"] = true
+    for name,_ in pairs(RESUME_RERUN) do
+        steps[name] = nil
+    end
+
+    return steps
+end
+
+--- Record a completed build step with the chroot, for e2-build --resume.
+-- @param res Result object
+-- @param rbs Result build set
+-- @param name Step name.
+-- @param mode "w" to start a new record, "a" to add to it.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function e2build.build_process_class:_record_step(res, rbs, name, mode)
+    local rc, re, bc, buildid, file, data
+
+    bc = res:build_config()
+    data = name .. "\n"
+    if mode == "w" then
+        buildid, re = res:buildid(rbs)
+        if not buildid then
+            return false, re
+        end
+        data = buildid .. "\n" .. data
+    end
+
+    file, re = eio.fopen(bc.steps_file, mode)
+    if not file then
+        return false, err.new("recording build step failed"):cat(re)
+    end
+
+    rc, re = eio.fwrite(file, data)
+    eio.fclose(file)
+    if not rc then
+        return false, err.new("recording build step failed"):cat(re)
+    end
+
+    return true
+end
+
 --- check if a chroot exists for this result
 -- @param res Result object
 -- @return True if chroot for result could be found, false otherwise.
@@ -254,7 +872,7 @@ function e2build.build_process_class:_enter_playground(res, rbs)
         return false, e:cat(re)
     end
 
-    table.insert(cmd, "chroot_2_3")
+    table.insert(cmd, chroot_command(bc))
     table.insert(cmd, bc.base)
 
     if #bc.chroot_call_prefix > 0 then
@@ -287,7 +905,7 @@ end
 -- @return an error object on failure
 function e2build.build_process_class:_result_available(res, rbs)
     local rc, re
-    local buildid, sbid
+    local buildid, sbid, scratch
     local e = err.new("error while checking if result is available: %s", res:get_name())
     local columns = tonumber(e2lib.globals.osenv["COLUMNS"])
     local e2project = e2tool.e2project()
@@ -298,9 +916,16 @@ function e2build.build_process_class:_result_available(res, rbs)
     end
 
     if rbs:build_mode().source_set() == "working-copy" then
-        assert(#buildid == digest.SHA1_LEN + 8 and
-            string.sub(buildid, 1, 8) == "scratch-")
-        sbid = string.format("%s...", string.sub(buildid, 1, 16))
+        scratch = string.sub(buildid, 1, 8) == "scratch-"
+        if scratch then
+            assert(#buildid == digest.SHA1_LEN + 8)
+            sbid = string.format("%s...", string.sub(buildid, 1, 16))
+        else
+            -- --wc-content, see policy
+            assert(#buildid == digest.SHA1_LEN + 3 and
+                string.sub(buildid, 1, 3) == "wc-")
+            sbid = string.format("%s...", string.sub(buildid, 1, 11))
+        end
     else
         assert(#buildid == digest.SHA1_LEN)
         sbid = string.format("%s...", string.sub(buildid, 1, 8))
@@ -312,8 +937,7 @@ function e2build.build_process_class:_result_available(res, rbs)
             columns, string.format("[%s] [playground]", sbid)))
         return true
     end
-    if rbs:build_mode().source_set() == "working-copy" or
-        rbs:build_settings():force_rebuild() then
+    if scratch or rbs:build_settings():force_rebuild() then
         rbs:message(e2lib.align(columns,
             0, string.format("building %-20s", res:get_name()),
             columns, string.format("[%s]", sbid)))
@@ -323,11 +947,9 @@ function e2build.build_process_class:_result_available(res, rbs)
     local server, location =
         rbs:build_mode().storage(
             e2project:project_location(), project.release_id())
-    local result_location = e2lib.join(location, res:get_name(),
-        buildid, "result.tar")
-
-    rc, re = cache.file_exists(cache.cache(), server, result_location)
-    if re then
+    rc, re = result_archive_lookup(server,
+        e2lib.join(location, res:get_name(), buildid))
+    if not rc and re then
         return false, e:cat(re)
     end
 
@@ -388,12 +1010,24 @@ function e2build.build_process_class:helper_chroot_remove(res, rbs)
     local e = err.new("removing chroot failed")
     local rc, re, bc
     bc = res:build_config()
+    rc, re = tmpfs.umount(res)
+    if not rc then
+        return false, e:cat(re)
+    end
     e2tool.set_umask()
     rc, re = e2lib.e2_su_2_2({"remove_chroot_2_3", bc.base})
     e2tool.reset_umask()
     if not rc then
         return false, e:cat(re)
     end
+    for _,f in ipairs({ bc.binds_file, bc.steps_file }) do
+        if e2lib.exists(f) then
+            rc, re = e2lib.unlink(f)
+            if not rc then
+                return false, e:cat(re)
+            end
+        end
+    end
     rc, re = e2lib.unlink(bc.chroot_marker)
     if not rc then
         return false, e:cat(re)
@@ -464,6 +1098,10 @@ function e2build.build_process_class:_setup_chroot(res, rbs)
         return false, e:cat(re)
     end
 
+    if tmpfs.enabled(res) then
+        tmpfs.mount(res)
+    end
+
     e2tool.set_umask()
     rc, re = e2lib.e2_su_2_2({"set_permissions_2_3", bc.base})
     e2tool.reset_umask()
@@ -494,6 +1132,10 @@ function e2build.build_process_class:_setup_chroot(res, rbs)
 
             e2tool.set_umask()
             local argv = { "extract_tar_2_3", bc.base, tartype, path }
+            if tartype == "tar.xz" or tartype == "tar.zst" then
+                table.insert(argv,
+                    string.format("%d", e2lib.globals.archive_threads))
+            end
             rc, re = e2lib.e2_su_2_2(argv)
             e2tool.reset_umask()
             if not rc then
@@ -507,7 +1149,7 @@ end
 ---
 -- @param res Result
 function e2build.build_process_class:_install_directory_structure(res)
-    local rc, re, e, bc, dirs
+    local rc, re, e, bc, dirs, bind
     bc = res:build_config()
     dirs = {"out", "init", "script", "build", "root", "env", "dep"}
     for _, v in pairs(dirs) do
@@ -517,6 +1159,18 @@ function e2build.build_process_class:_install_directory_structure(res)
             return false, e:cat(re)
         end
     end
+
+    if compiler_cache(res) then
+        bind, re = ccache.checkout(res)
+        if not bind then
+            return false, re
+        end
+        rc, re = add_binds(bc, { bind })
+        if not rc then
+            e = err.new("setting up the compiler cache failed")
+            return false, e:cat(re)
+        end
+    end
     return true
 end
 
@@ -546,7 +1200,14 @@ function e2build.build_process_class:_install_env(res, rbs)
     bc = res:build_config()
 
     -- install builtin environment variables
-    rc, re = res:builtin_env(rbs):tofile(e2lib.join(bc.T, "env/builtin"))
+    builtin_env = res:builtin_env(rbs)
+    if jobserver.enabled() then
+        builtin_env:set("MAKEFLAGS", jobserver.makeflags())
+    end
+    if compiler_cache(res) then
+        ccache.env(res, builtin_env)
+    end
+    rc, re = builtin_env:tofile(e2lib.join(bc.T, "env/builtin"))
     if not rc then
         return false, e:cat(re)
     end
@@ -607,6 +1268,15 @@ function e2build.build_process_class:_install_build_driver(res)
         string.format("source %s/env/env\n", bc.Tc)
     }
 
+    if jobserver.enabled() then
+        -- join the jobserver, see _install_env()
+        table.insert(bd, "export MAKEFLAGS\n")
+    end
+
+    if compiler_cache(res) then
+        table.insert(bd, "export CCACHE_DIR CCACHE_BASEDIR CCACHE_MAXSIZE\n")
+    end
+
 
     -- write buildrc file (for interactive use, without sourcing init files)
     buildrc_noinit_file = e2lib.join(destdir, bc.buildrc_noinit_file)
@@ -635,8 +1305,16 @@ function e2build.build_process_class:_install_build_driver(res)
     end
 
     table.insert(bd, "set\n")
+    if compiler_cache(res) then
+        table.insert(bd, "ccache -z >/dev/null 2>&1 || true\n")
+    end
     table.insert(bd, string.format("cd %s/build\n", bc.Tc))
     table.insert(bd, string.format("source %s/script/build-script\n", bc.Tc))
+    if compiler_cache(res) then
+        table.insert(bd, string.format(
+            "ccache --print-stats >%s/%s 2>/dev/null || true\n",
+            bc.Tc, ccache.statsfile))
+    end
 
     -- write the build driver
     build_driver_file = e2lib.join(destdir, bc.build_driver_file)
@@ -648,24 +1326,30 @@ function e2build.build_process_class:_install_build_driver(res)
     return true
 end
 
+--- Error of helper_unpack_result(), created on failure only.
+-- @param dep Result (dependency).
+-- @param re Error object of the failing operation.
+-- @return Error object.
+local function unpack_error(dep, re)
+    return err.new("unpacking result failed: %s", dep:get_name()):cat(re)
+end
+
 ---
 -- @param res Result
 -- @param dep Result (dependency).
 -- @param destdir Destination directory
 -- @param rbs Result build set
 function e2build.build_process_class:helper_unpack_result(res, dep, destdir, rbs)
-    local rc, re, e
-    local buildid, server, location, resulttarpath, tmpdir
-    local path, resdir, dt, filesdir, e2project, dep_rbs
-
-    e = err.new("unpacking result failed: %s", dep:get_name())
+    local rc, re, eno
+    local buildid, server, location, tmpdir, src
+    local resdir, filesdir, e2project, dep_rbs
 
     e2project = e2tool.e2project()
 
     dep_rbs = rbs:build_set():result_build_set(dep:get_name())
     buildid, re = dep:buildid(dep_rbs)
     if not buildid then
-        return false, e:cat(re)
+        return false, unpack_error(dep, re)
     end
 
     server, location =
@@ -674,36 +1358,20 @@ function e2build.build_process_class:helper_unpack_result(res, dep, destdir, rbs
     e2lib.logf(3, "searching for dependency %s in %s:%s",
         dep:get_name(), server, location)
 
-    resulttarpath = e2lib.join(location, dep:get_name(), buildid, "result.tar")
-    path, re = cache.fetch_file_path(cache.cache(), server, resulttarpath)
-    if not path then
-        return false, e:cat(re)
-    end
-
     tmpdir, re = e2lib.mktempdir()
     if not tmpdir then
-        return false, e:cat(re)
+        return false, unpack_error(dep, re)
     end
 
     resdir = e2lib.join(tmpdir, "result")
     rc, re = e2lib.mkdir(resdir)
     if not rc then
-        return false, e:cat(re)
-    end
-    rc, re = e2lib.tar({ "-xf", path, "-C", resdir })
-    if not rc then
-        return false, e:cat(re)
-    end
-
-    dt, re = digest.parse(e2lib.join(resdir, "checksums"))
-    if not dt then
-        return false, e:cat(re)
+        return false, unpack_error(dep, re)
     end
 
-    rc, re = digest.verify(dt, resdir)
+    rc, re = result_unpack(server, location, dep:get_name(), buildid, resdir)
     if not rc then
-        e:append("checksum mismatch in dependency: %s", dep:get_name())
-        return false, e:cat(re)
+        return false, unpack_error(dep, re)
     end
 
     -- bc = dep:build_config()
@@ -711,17 +1379,22 @@ function e2build.build_process_class:helper_unpack_result(res, dep, destdir, rbs
 
     rc, re = e2lib.mkdir_recursive(destdir)
     if not rc then
-        return false, e:cat(re)
+        return false, unpack_error(dep, re)
     end
     filesdir = e2lib.join(resdir, "files")
-    for f, re in e2lib.directory(filesdir) do
+    for f, re in e2lib.readdir(filesdir) do
         if not f then
-            return false, e:cat(re)
+            return false, unpack_error(dep, re)
         end
 
-        rc, re = e2lib.mv(e2lib.join(filesdir, f), destdir)
+        -- rename in place, mv only across file systems
+        src = e2lib.join(filesdir, f)
+        rc, re, eno = e2lib.rename(src, e2lib.join(destdir, f))
+        if not rc and eno == errno.def2errnum("EXDEV") then
+            rc, re = e2lib.mv(src, destdir)
+        end
         if not rc then
-            return false, e:cat(re)
+            return false, unpack_error(dep, re)
         end
     end
 
@@ -730,22 +1403,85 @@ function e2build.build_process_class:helper_unpack_result(res, dep, destdir, rbs
     return true
 end
 
+--- Get the tree of a dependency unpacked in the source cache, for bind
+-- mounting it read-only into the chroot.
+-- @param res Result
+-- @param dep Result (dependency).
+-- @param rbs Result build set
+-- @return Path of the tree, false if the dependency is not cacheable, or
+--         nil on error.
+-- @return Error object on failure.
+function e2build.build_process_class:helper_dependency_tree(res, dep, rbs)
+    local buildid, re, hc, key, tree
+
+    buildid, re = dep:buildid(rbs:build_set():result_build_set(dep:get_name()))
+    if not buildid then
+        return nil, re
+    end
+
+    -- scratch and working-copy results are not unpacked more than once
+    if not string.match(buildid, "^%x+$") then
+        return false
+    end
+
+    hc = hash.hash_start()
+    hash.hash_line(hc, "dependency")
+    hash.hash_line(hc, buildid)
+    key = hash.hash_finish(hc)
+
+    tree, re = srccache.entry(res:build_config().srccache_store, key,
+        "dependency " .. dep:get_name(),
+        function(tree)
+            return self:helper_unpack_result(res, dep, tree, rbs)
+        end)
+    if not tree then
+        return nil, re
+    end
+
+    return tree
+end
+
 ---
 -- @param res Result
 -- @param rbs Result build set
 function e2build.build_process_class:_install_build_time_dependencies(res, rbs)
-    local e, rc, re
-    local dependslist, dep, destdir
+    local e, rc, re, bc, readonly
+    local dependslist, dep, destdir, tree
 
+    bc = res:build_config()
     dependslist = res:depends_list()
+    readonly = project.readonly_deps() and res:readonly_deps() and
+        dependslist:size() > 0 and bind_supported(bc)
 
     for dependsname in dependslist:iter() do
         dep = result.results[dependsname]
-        destdir = e2lib.join(res:build_config().T, "dep", dep:get_name())
+        destdir = e2lib.join(bc.T, "dep", dep:get_name())
 
-        rc, re = self:helper_unpack_result(res, dep, destdir, rbs)
-        if not rc then
-            return false, re
+        tree = false
+        if readonly then
+            tree, re = self:helper_dependency_tree(res, dep, rbs)
+            if tree == nil then
+                return false, re
+            end
+        end
+
+        if tree then
+            -- mount point, the destination is relative to the chroot
+            rc, re = e2lib.mkdir_recursive(destdir)
+            if not rc then
+                return false, re
+            end
+            -- listed right away, which keeps the tree from being evicted
+            rc, re = add_binds(bc, { string.format("%s\t%s\n", tree,
+                string.sub(e2lib.join(bc.Tc, "dep", dep:get_name()), 2)) })
+            if not rc then
+                return false, re
+            end
+        else
+            rc, re = self:helper_unpack_result(res, dep, destdir, rbs)
+            if not rc then
+                return false, re
+            end
         end
     end
 
@@ -766,7 +1502,7 @@ function e2build.build_process_class:_install_sources(res, rbs)
         e = err.new("installing source failed: %s", sourcename)
         src = source.sources[sourcename]
 
-        rc, re = src:prepare_source(source_set, destdir)
+        rc, re = srccache.prepare_source(res, src, source_set, destdir)
         if not rc then
             return false, e:cat(re)
         end
@@ -847,7 +1583,7 @@ function e2build.build_process_class:_runbuild(res)
         return false, e:cat(re)
     end
 
-    table.insert(cmd, "chroot_2_3")
+    table.insert(cmd, chroot_command(bc))
     table.insert(cmd, bc.base)
     table.insert(cmd, "/bin/bash")
     table.insert(cmd, "-e")
@@ -858,12 +1594,24 @@ function e2build.build_process_class:_runbuild(res)
         table.insert(cmd, 1, bc.chroot_call_prefix)
     end
 
+    local cg, ru1, ru2, t1
+    cg = accounting.cgroup_wrap(res:get_name(), cmd)
+    ru1, re = e2lib.getrusage_children()
+    if not ru1 then
+        eio.fclose(out)
+        return false, e:cat(re)
+    end
+    t1 = e2lib.monotime()
+
     rc, re = e2lib.callcmd_capture(cmd, logto, nil, nil, true) -- pty=true
     if not rc then
         eio.fclose(out)
         return false, e:cat(re)
     end
     e2tool.reset_umask()
+
+    ru2 = e2lib.getrusage_children() or ru1
+    accounting.build(res:get_name(), cg, e2lib.monotime() - t1, ru1, ru2)
     if rc ~= 0 then
         eio.fclose(out)
         e = err.new("build script for %s failed with exit status %d", res:get_name(), rc)
@@ -879,6 +1627,16 @@ function e2build.build_process_class:_runbuild(res)
     return true
 end
 
+--- Collect the compiler cache statistics of the build.
+-- @param res Result
+function e2build.build_process_class:_compiler_cache_stats(res)
+    if not compiler_cache(res) then
+        return true
+    end
+
+    return ccache.stats(res)
+end
+
 --- deploy a result to the archive
 -- @param res Result
 -- @param tmpdir Directory containing the result etc.
@@ -892,7 +1650,7 @@ function e2build.build_process_class:helper_deploy(res, tmpdir, rbs)
     ./result/build.log.gz
     ./result/checksums
     ./result/files/*
-    ./result.tar
+    ./result.tar (or the archive in the project result_format)
 
     This function pushes the result files and the checksum file as follows:
     -- result/checksums
@@ -909,51 +1667,42 @@ function e2build.build_process_class:helper_deploy(res, tmpdir, rbs)
         e2lib.log(4, "deployment disabled for this result")
         return true
     end
-    local files = {}
-    local re
-
+    local rc, re
     local filesdir = e2lib.join(tmpdir, "result/files")
     local resdir = e2lib.join(tmpdir, "result")
-
-    for f, re in e2lib.directory(filesdir) do
-        if not f then
-            return false, re
-        end
-
-        table.insert(files, e2lib.join("files", f))
-    end
-    table.insert(files, "checksums")
     local server, location = rbs:build_mode().deploy_storage(
         e2project:project_location(), project.release_id())
+    location = e2lib.join(location, res:get_name())
 
     -- do not re-deploy if this release was already done earlier
-    local location1 = e2lib.join(location, res:get_name(), "checksums")
     local cache_flags = {
         cache = false,
     }
-    local rc, re = cache.fetch_file(cache.cache(), server, location1, tmpdir,
-        nil, cache_flags)
+    rc, re = cache.file_exists(cache.cache(), server,
+        e2lib.join(location, "checksums"), cache_flags)
     if rc then
         e2lib.warnf("WOTHER",
             "Skipping deployment. This release was already deployed.")
         return true
     end
 
-
     e2lib.logf(1, "deploying %s to %s:%s", res:get_name(), server, location)
     local cache_flags = {}
 
-    for _,f in ipairs(files) do
-        local sourcefile, location1
+    -- push all files in one transfer, the checksums file goes last so
+    -- an incomplete deployment can be detected (and is not skipped).
+    rc, re = cache.push_directory(cache.cache(), filesdir, server,
+        e2lib.join(location, "files"), cache_flags)
+    if not rc then
+        return false, re
+    end
 
-        sourcefile = e2lib.join(resdir, f)
-        location1 = e2lib.join(location, res:get_name(), f)
-        rc, re = cache.push_file(cache.cache(), sourcefile, server, location1,
-            cache_flags)
-        if not rc then
-            return false, re
-        end
+    rc, re = cache.push_file(cache.cache(), e2lib.join(resdir, "checksums"),
+        server, e2lib.join(location, "checksums"), { barrier = true })
+    if not rc then
+        return false, re
     end
+
     if cache.writeback_enabled(cache.cache(), server, cache_flags) == false then
         e2lib.warnf("WOTHER",
             "Writeback is disabled for server %q. Release not deployed!", server)
@@ -962,6 +1711,167 @@ function e2build.build_process_class:helper_deploy(res, tmpdir, rbs)
     return true
 end
 
+--- Determine the archive entries of a result stored as a delta. The delta
+-- base is the BuildID configured in e2project result_delta.base, or the
+-- result the out/<result>/last link points to. Unchanged files are left out
+-- and reassembled from the base when the result is unpacked. Failing to
+-- compute a delta is not an error, the result is stored in full instead.
+-- @param res Result
+-- @param rbs Result build set
+-- @param dt Digest table of the result files.
+-- @param resdir Directory containing the result structure.
+-- @return Vector of archive entries relative to resdir, or false if the
+--         result should be stored in full.
+function e2build.build_process_class:helper_result_delta(res, rbs, dt, resdir)
+    local rc, re, e2project, server, location, buildid, basebid, lnk
+    local fullbid, tmpdir, basedir, basedt, unchanged, entries, nchanged
+
+    if not project.result_delta() or
+        rbs:build_mode().source_set() == "working-copy" then
+        return false
+    end
+
+    buildid, re = res:buildid(rbs)
+    if not buildid then
+        return false
+    end
+
+    basebid = project.result_delta_base(res:get_name())
+    if not basebid then
+        lnk = e2lib.join(e2tool.root(), "out", res:get_name(), "last")
+        rc = e2lib.readlink(lnk)
+        if rc then
+            basebid = e2lib.basename(rc)
+        end
+    end
+
+    if not basebid or basebid == buildid or #basebid ~= digest.SHA1_LEN then
+        return false
+    end
+
+    e2project = e2tool.e2project()
+    server, location = rbs:build_mode().storage(
+        e2project:project_location(), project.release_id())
+
+    -- a delta always refers to a full result, use the base of the base
+    -- if required
+    fullbid, re = result_base(server, location, res:get_name(), basebid)
+    if fullbid then
+        tmpdir, re = e2lib.mktempdir()
+    end
+    if fullbid and tmpdir then
+        basedir = e2lib.join(tmpdir, "result")
+        rc, re = e2lib.mkdir(basedir)
+        if rc then
+            basedt, re = result_unpack(server, location, res:get_name(),
+                fullbid, basedir, true)
+        end
+        e2lib.rmtempdir(tmpdir)
+    end
+
+    if not basedt then
+        e2lib.warnf("WOTHER", "%s: delta base %s is not available: %s",
+            res:get_name(), basebid, re:tostring())
+        e2lib.warnf("WOTHER", "%s: storing full result", res:get_name())
+        return false
+    end
+    basebid = fullbid
+
+    unchanged = {}
+    for _,entry in ipairs(basedt) do
+        if entry.digest == digest.SHA1 then
+            unchanged[entry.name] = string.lower(entry.checksum)
+        end
+    end
+
+    rc, re = eio.file_write(e2lib.join(resdir, "base"), basebid .. "\n")
+    if not rc then
+        return false
+    end
+
+    entries = { "base", "build.log.gz", "checksums" }
+    nchanged = 0
+    for _,entry in ipairs(dt) do
+        if unchanged[entry.name] ~= entry.checksum then
+            table.insert(entries, entry.name)
+            nchanged = nchanged + 1
+        end
+    end
+
+    e2lib.logf(2, "%s: storing %d of %d files as delta against %s",
+        res:get_name(), nchanged, digest.count(dt), basebid)
+
+    return entries
+end
+
+--- Create the result archive in the project result_format and store it.
+-- @param res Result
+-- @param rbs Result build set
+-- @param server Server name.
+-- @param resultdir Location of the result directory on the server.
+-- @param tmpdir Directory containing the result structure in "result".
+-- @param dt Digest table of the result files.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function e2build.build_process_class:helper_store_archive(res, rbs, server,
+    resultdir, tmpdir, dt)
+    local rc, re, archive, argv, entries
+    local resdir = e2lib.join(tmpdir, "result")
+
+    -- archive in the project result_format, compressed if configured
+    archive = "result." .. project.result_format()
+    argv, re = e2lib.tar_compress_flags(project.result_format())
+    if not argv then
+        return false, re
+    end
+
+    -- do not include the "." directory in the result archive
+    for _,arg in ipairs({ "-cf",  e2lib.join(tmpdir, archive), "-C", resdir,
+        "--" }) do
+        table.insert(argv, arg)
+    end
+
+    entries = self:helper_result_delta(res, rbs, dt, resdir)
+    if entries then
+        for _,entry in ipairs(entries) do
+            table.insert(argv, entry)
+        end
+    else
+        for entry, re in e2lib.directory(resdir, true) do
+            if not entry then
+                return false, re
+            end
+            table.insert(argv, entry)
+        end
+    end
+    rc, re = e2lib.tar(argv)
+    if not rc then
+        return false, re
+    end
+
+    -- the delta base is looked up without fetching the archive
+    if entries then
+        rc, re = cache.push_file(cache.cache(), e2lib.join(resdir, "base"),
+            server, e2lib.join(resultdir, "base"))
+        if not rc then
+            return false, re
+        end
+    end
+
+    -- written back after the output digest, also with the writeback queue
+    local cache_flags = {
+        try_hardlink = true,
+        barrier = true,
+    }
+    rc, re = cache.push_file(cache.cache(), e2lib.join(tmpdir, archive), server,
+        e2lib.join(resultdir, archive), cache_flags)
+    if not rc then
+        return false, re
+    end
+
+    return true
+end
+
 --- store the result
 -- @param res Result
 -- @param rbs Result build set
@@ -991,28 +1901,46 @@ function e2build.build_process_class:_store_result(res, rbs)
     if not rc then
         return false, e:cat(re)
     end
-    local nfiles = 0
-    for f in e2lib.directory(rfilesdir, false, true) do
-        e2lib.logf(3, "result file: %s", f)
-        local s = e2lib.join(rfilesdir, f)
-        local d = e2lib.join(filesdir, f)
+    -- Change owner and group of output files to match destination
+    -- directory and make hardlink() happy on security sensitive kernels.
+    local sb, re = e2lib.stat(filesdir)
+    if not sb then
+        return false, e:cat(re)
+    end
 
-        -- Change owner and group of output files to match destination
-        -- directory and make hardlink() happy on security sensitive kernels.
-        local sb, re = e2lib.stat(filesdir)
-        if not sb then
+    local files = {}
+    for f, re in e2lib.readdir(rfilesdir, false, true) do
+        if not f then
             return false, e:cat(re)
         end
+        e2lib.logf(3, "result file: %s", f)
+        table.insert(files, f)
+    end
+    if #files < 1 then
+        e:append("No output files available.")
+        e:append("Please make sure your build script leaves at least one file in")
+        e:append("the output directory.")
+        return false, e
+    end
 
-        local argv = { "chroot_2_3", bc.base, "chown", "--",
-            string.format("%s:%s", sb.uid, sb.gid),
-            e2lib.join(bc.Tc, "out", f)
-        }
+    -- one chown call for many files
+    local owner = string.format("%s:%s", sb.uid, sb.gid)
+    for i = 1, #files, CHOWN_FILES do
+        local argv = { "chroot_2_3", bc.base, "chown", "--", owner }
+        for j = i, math.min(i + CHOWN_FILES - 1, #files) do
+            table.insert(argv, e2lib.join(bc.Tc, "out", files[j]))
+        end
 
         rc, re = e2lib.e2_su_2_2(argv)
         if not rc then
             return false, e:cat(re)
         end
+    end
+
+    dt = digest.new()
+    for _,f in ipairs(files) do
+        local s = e2lib.join(rfilesdir, f)
+        local d = e2lib.join(filesdir, f)
 
         rc, re = e2lib.hardlink(s, d)
         if not rc then
@@ -1024,20 +1952,6 @@ function e2build.build_process_class:_store_result(res, rbs)
                 return false, e:cat(re)
             end
         end
-        nfiles = nfiles + 1
-    end
-    if nfiles < 1 then
-        e:append("No output files available.")
-        e:append("Please make sure your build script leaves at least one file in")
-        e:append("the output directory.")
-        return false, e
-    end
-
-    dt = digest.new()
-    for f,re in e2lib.directory(filesdir, false, true) do
-        if not f then
-            return false, e:cat(re)
-        end
 
         digest.new_entry(dt, digest.SHA1, nil, e2lib.join("files", f), nil)
     end
@@ -1062,20 +1976,6 @@ function e2build.build_process_class:_store_result(res, rbs)
         return false, e:cat(re)
     end
 
-    -- do not include the "." directory in result.tar
-    local argv = { "-cf",  e2lib.join(tmpdir, "result.tar"), "-C", resdir, "--" }
-
-    for entry, re in e2lib.directory(resdir, true) do
-        if not entry then
-            return false, e:cat(re)
-        end
-        table.insert(argv, entry)
-    end
-    rc, re = e2lib.tar(argv)
-    if not rc then
-        return false, e:cat(re)
-    end
-
     local server, location = rbs:build_mode().storage(
         e2project:project_location(), project.release_id())
 
@@ -1084,16 +1984,30 @@ function e2build.build_process_class:_store_result(res, rbs)
         return false, re
     end
 
-    local sourcefile = e2lib.join(tmpdir, "result.tar")
-    local location1 = e2lib.join(location, res:get_name(), buildid, "result.tar")
-    local cache_flags = {
-        try_hardlink = true,
-    }
-    rc, re = cache.push_file(cache.cache(), sourcefile, server,
-        location1, cache_flags)
-    if not rc then
-        return false, e:cat(re)
+    local resultdir = e2lib.join(location, res:get_name(), buildid)
+
+    -- scratch buildids are never looked up
+    if project.early_cutoff() and string.sub(buildid, 1, 8) ~= "scratch-" then
+        rc, re = outputid.record(res:get_name(), buildid, dt, server,
+            resultdir, tmpdir)
+        if not rc then
+            return false, e:cat(re)
+        end
+    end
+
+    if project.result_format() == "objects" then
+        rc, re = result_store_objects(server, location, resultdir, resdir, dt)
+        if not rc then
+            return false, e:cat(re)
+        end
+    else
+        rc, re = self:helper_store_archive(res, rbs, server, resultdir, tmpdir,
+            dt)
+        if not rc then
+            return false, e:cat(re)
+        end
     end
+
     rc, re = self:helper_deploy(res, tmpdir, rbs)
     if not rc then
         return false, e:cat(re)
@@ -1122,7 +2036,12 @@ function e2build.build_process_class:_linklast(res, rbs)
         return false, e:cat(re)
     end
     lnk = e2lib.join(e2tool.root(),  "out", res:get_name(), "last")
-    location = e2lib.join(location, res:get_name(), buildid, "result.tar")
+    location, re = result_archive_lookup(server,
+        e2lib.join(location, res:get_name(), buildid))
+    if not location then
+        re = re or err.new("result archive not found for %s", res:get_name())
+        return false, e:cat(re)
+    end
 
     -- if we don't have cache or server on local fs, fetch a copy into "out"
     if not cache.cache_enabled(cache.cache(), server) and not
@@ -1248,6 +2167,7 @@ function e2build.build_settings_class:initialize()
         self._force_rebuild = false
         self._keep_chroot = false
         self._prep_playground = false
+        self._resume = false
 end
 
 ---
@@ -1268,6 +2188,15 @@ function e2build.build_settings_class:keep_chroot(value)
     return self._keep_chroot
 end
 
+---
+function e2build.build_settings_class:resume(value)
+    if value ~= nil then
+        assertIsBoolean(value)
+        self._resume = value
+    end
+    return self._resume
+end
+
 ---
 function e2build.build_settings_class:prep_playground(value)
     if value ~= nil then
@@ -327,16 +327,24 @@ function e2tool.file_class:_compute_remote_checksum(digest_type)
     return false
 end
 
+--- Error of file_class:fileid(). FileIDs are calculated for every file of
+-- every result, the error object is only created when it fails.
+-- @param file File object.
+-- @param re Error object of the failing operation.
+-- @return Error object.
+local function fileid_error(file, re)
+    return err.new("error calculating file id for file: %s",
+        file:servloc()):cat(re)
+end
+
 --- Calculate the FileID for a file.
 -- This includes the checksum of the file as well as all set attributes.
 -- @return FileID string: hash value, or false on error.
 -- @return an error object on failure
 function e2tool.file_class:fileid()
-    local rc, re, e, hc, cs, fid
+    local rc, re, hc, cs, fid
     local cs_done = false
 
-    e = err.new("error calculating file id for file: %s", self:servloc())
-
     hc = hash.hash_start()
     hash.hash_append(hc, self._server)
     hash.hash_append(hc, self._location)
@@ -347,7 +355,7 @@ function e2tool.file_class:fileid()
         else
             cs, re = self:_compute_checksum(digest.SHA1)
             if not cs then
-                return false, e:cat(re)
+                return false, fileid_error(self, re)
             end
             hash.hash_append(hc, cs)
         end
@@ -360,7 +368,7 @@ function e2tool.file_class:fileid()
         else
             cs, re = self:_compute_checksum(digest.SHA256)
             if not cs then
-                return false, e:cat(re)
+                return false, fileid_error(self, re)
             end
             hash.hash_append(hc, cs)
         end
@@ -372,7 +380,7 @@ function e2tool.file_class:fileid()
     if policy.opts.check_remote() then
         rc, re = self:checksum_verify()
         if not rc then
-            return false, e:cat(re)
+            return false, fileid_error(self, re)
         end
     end
 
@@ -382,7 +390,7 @@ function e2tool.file_class:fileid()
         for licencename in self._licences:iter() do
             local lid, re = licence.licences[licencename]:licenceid()
             if not lid then
-                return false, e:cat(re)
+                return false, fileid_error(self, re)
             end
             hash.hash_append(hc, lid)
         end
@@ -791,7 +799,12 @@ function e2tool.e2project_class:_init_umask()
 end
 
 --- Load the project configuration.
-function e2tool.e2project_class:load_project(skip_load_config)
+-- @param skip_load_config Only do basic initialization, load no config files.
+-- @param lazy Load results and sources on first access only, see
+--             result.load_result_configs(). Optional.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function e2tool.e2project_class:load_project(skip_load_config, lazy)
     local e = err.new("error loading project configuration")
     local rc, re
 
@@ -898,18 +911,23 @@ function e2tool.e2project_class:load_project(skip_load_config)
         return false, e:cat(re)
     end
 
+    local t1 = e2lib.monotime()
+
     -- sources
-    rc, re = source.load_source_configs()
+    rc, re = source.load_source_configs(lazy)
     if not rc then
         return false, e:cat(re)
     end
 
     -- results
-    rc, re = result.load_result_configs()
+    rc, re = result.load_result_configs(lazy)
     if not rc then
         return false, e:cat(re)
     end
 
+    e2lib.logf(3, "loading sources and results took %.3fs",
+        e2lib.monotime() - t1)
+
     -- project result envs must be checked after loading results
     rc, re = projenv.verify_result_envs()
     if not rc then
@@ -917,7 +935,7 @@ function e2tool.e2project_class:load_project(skip_load_config)
     end
 
     -- after results are loaded, verify the project configuration
-    rc, re = project.verify_project_config()
+    rc, re = project.verify_project_config(lazy)
     if not rc then
         return false, e:cat(re)
     end
@@ -1237,6 +1255,43 @@ function e2tool.sourceconfig(name, prefix)
     return e2lib.join(e2tool.sourcedir(name, prefix), "config")
 end
 
+--- Find the config of a source or result by name, without scanning the
+-- source or result tree. Follows the rules of the scan: the search ends at
+-- the first directory holding a config file.
+-- @param name Full source or result name, including groups (string).
+-- @param configfunc e2tool.sourceconfig or e2tool.resultconfig.
+-- @return Path of the source or result (ex: group/name), or false if there
+--         is no config for the name.
+function e2tool.src_res_lookup(name, configfunc)
+    assertIsString(name)
+    assertIsFunction(configfunc)
+
+    local path
+
+    if not e2tool.verify_src_res_name_valid_chars(name)
+        or name:find("..", 1, true) or name:match("^%.")
+        or name:match("%.$") then
+        return false
+    end
+
+    for component in name:gmatch("[^.]+") do
+        if path then
+            path = e2lib.join(path, component)
+        else
+            path = component
+        end
+
+        if e2lib.exists(configfunc(path, e2tool.root())) then
+            if e2tool.src_res_path_to_name(path) == name then
+                return path
+            end
+            return false
+        end
+    end
+
+    return false
+end
+
 --- Returns a sorted vector with all depdencies of result, and all
 -- the indirect dependencies. If result is a vector, calculates dependencies
 -- for all results and includes those from result. If result is a result name,
@@ -0,0 +1,97 @@
+--- GNU make compatible jobserver. A pipe is filled with job tokens and its
+-- file descriptors are inherited by the builds in the chroot environments.
+-- GNU make finds the jobserver through MAKEFLAGS, so all make processes
+-- started by one e2-build share a single limit of parallel jobs.
+-- @module local.jobserver
+
+-- Copyright (C) 2007-2016 emlix GmbH, see file AUTHORS
+--
+-- This file is part of e2factory, the emlix embedded build system.
+-- For more information see http://www.e2factory.org
+--
+-- e2factory is a registered trademark of emlix GmbH.
+--
+-- e2factory is free software: you can redistribute it and/or modify it under
+-- the terms of the GNU General Public License as published by the
+-- Free Software Foundation, either version 3 of the License, or (at your
+-- option) any later version.
+--
+-- This program is distributed in the hope that it will be useful, but WITHOUT
+-- ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+-- FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+-- more details.
+
+local jobserver = {}
+local e2lib = require("e2lib")
+local eio = require("eio")
+local err = require("err")
+local strict = require("strict")
+
+--- Upper limit of jobs, the tokens must fit into the pipe buffer.
+local MAX_JOBS = 4096
+
+local _jobs = 0
+local _rfd = false
+local _wfd = false
+
+--- Start the jobserver. The pipe holds jobs - 1 tokens, each make started by
+-- a build owns one implicit token, as the top level make does.
+-- @param jobs Maximum number of parallel jobs.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function jobserver.start(jobs)
+    assertIsNumber(jobs)
+    assert(not _rfd, "jobserver already started")
+
+    local rc, re, rfd, wfd
+    local e = err.new("starting the jobserver failed")
+
+    if jobs < 1 or jobs > MAX_JOBS or jobs ~= math.floor(jobs) then
+        return false, e:append("number of jobs must be between 1 and %d",
+            MAX_JOBS)
+    end
+
+    rfd, wfd = eio.pipe()
+    if not rfd then
+        return false, e:cat(wfd)
+    end
+
+    if jobs > 1 then
+        rc, re = eio.write(wfd, string.rep("+", jobs - 1))
+        if not rc then
+            eio.close(rfd)
+            eio.close(wfd)
+            return false, e:cat(re)
+        end
+    end
+
+    _jobs = jobs
+    _rfd = rfd
+    _wfd = wfd
+
+    e2lib.logf(3, "jobserver: %d jobs on fds %d,%d", _jobs, _rfd, _wfd)
+
+    return true
+end
+
+--- Check whether the jobserver is running.
+-- @return True or false.
+function jobserver.enabled()
+    return _rfd ~= false
+end
+
+--- MAKEFLAGS for make processes joining the jobserver. Builds must not pass
+-- -j to make themselves, otherwise make leaves the jobserver.
+-- @return MAKEFLAGS string, or false if the jobserver is not running.
+function jobserver.makeflags()
+    if not _rfd then
+        return false
+    end
+
+    return string.format("-j%d --jobserver-auth=%d,%d --jobserver-fds=%d,%d",
+        _jobs, _rfd, _wfd, _rfd, _wfd)
+end
+
+return strict.lock(jobserver)
+
+-- vim:sw=4:sts=4:et:
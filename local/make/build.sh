@@ -42,11 +42,14 @@ for s in $SOURCE ; do
 	mkdir -p $dst
 	make BUILD=$dst -C src/$s place
 done
-# install deps
+# install deps, hardlinked if out/ and the chroot share a file system
 for d in $DEPEND ; do
 	dst=$chroot_path/tmp/e2/dep
 	mkdir -p $dst
-	cp -v -r out/$d $dst/
+	if ! cp -v -r -l out/$d $dst/ ; then
+		rm -rf $dst/$d
+		cp -v -r out/$d $dst/
+	fi
 done
 # install result stuff
 mkdir -p $chroot_path/tmp/e2/{script,init,env,dep,build,out,root}
@@ -0,0 +1,160 @@
+--- Output digests of built results, for early cutoff. Maps the BuildID of a
+-- result to a digest of its checksums manifest, recorded when the result is
+-- stored. With e2project early_cutoff, results hash the output digest of a
+-- dependency instead of its BuildID, a dependency rebuilt with identical
+-- output does not change the BuildIDs above it.
+-- The digest is stored with the result on the results server, in
+-- <result>/<buildid>/outputid, so every checkout sharing the server
+-- calculates the same BuildIDs.
+-- @module local.outputid
+
+-- Copyright (C) 2007-2016 emlix GmbH, see file AUTHORS
+--
+-- This file is part of e2factory, the emlix embedded build system.
+-- For more information see http://www.e2factory.org
+--
+-- e2factory is a registered trademark of emlix GmbH.
+--
+-- e2factory is free software: you can redistribute it and/or modify it under
+-- the terms of the GNU General Public License as published by the
+-- Free Software Foundation, either version 3 of the License, or (at your
+-- option) any later version.
+--
+-- This program is distributed in the hope that it will be useful, but WITHOUT
+-- ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+-- FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+-- more details.
+
+local outputid = {}
+package.loaded["outputid"] = outputid -- prevent module loading loop
+
+local cache = require("cache")
+local e2lib = require("e2lib")
+local e2tool = require("e2tool")
+local eio = require("eio")
+local err = require("err")
+local hash = require("hash")
+local project = require("project")
+local strict = require("strict")
+
+--- Name of the digest file in the result directory on the server.
+local OUTPUTID = "outputid"
+
+local _ids = {}         -- output digests by BuildID, false if there is none
+local _generation = 0   -- number of digests recorded in this run
+
+--- Look up the output digest of a result on the results server.
+-- @param resultname Result name.
+-- @param rbs Result build set of the result.
+-- @param buildid BuildID of the result.
+-- @return Output digest, or false if the result was not stored with one.
+-- @return Error object on failure.
+function outputid.lookup(resultname, rbs, buildid)
+    assertIsStringN(resultname)
+    assertIsTable(rbs)
+    assertIsStringN(buildid)
+
+    local rc, re, e, server, location, path, id
+
+    if _ids[buildid] ~= nil then
+        return _ids[buildid]
+    end
+
+    -- scratch buildids are never recorded
+    if string.sub(buildid, 1, 8) == "scratch-" then
+        return false
+    end
+
+    e = err.new("looking up the output digest of %s failed", resultname)
+    server, location = rbs:build_mode().storage(
+        e2tool.e2project():project_location(), project.release_id())
+    location = e2lib.join(location, resultname, buildid, OUTPUTID)
+
+    rc, re = cache.file_exists(cache.cache(), server, location)
+    if re then
+        return false, e:cat(re)
+    end
+
+    id = false
+    if rc then
+        path, re = cache.fetch_file_path(cache.cache(), server, location)
+        if not path then
+            return false, e:cat(re)
+        end
+
+        id, re = eio.file_read_line(path)
+        if not id then
+            return false, e:cat(re)
+        end
+        if not string.match(id, "^%x+$") then
+            return false, e:append("malformed output digest: %s", id)
+        end
+    end
+
+    _ids[buildid] = id
+    return id
+end
+
+--- Store the output digest of a result with the result. Called before the
+-- result itself is pushed, so a stored result always has its digest.
+-- @param resultname Result name, part of the digest.
+-- @param buildid BuildID of the result.
+-- @param dt Digest table of the result files, as written to its checksums
+--           file.
+-- @param server Results server name.
+-- @param resultdir Location of the result directory on the server.
+-- @param tmpdir Temporary directory to write the digest file in.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function outputid.record(resultname, buildid, dt, server, resultdir, tmpdir)
+    assertIsStringN(resultname)
+    assertIsStringN(buildid)
+    assertIsTable(dt)
+    assertIsStringN(server)
+    assertIsStringN(resultdir)
+    assertIsStringN(tmpdir)
+
+    local rc, re, e, hc, id, file
+
+    e = err.new("recording output digest failed")
+    hc = hash.hash_start()
+    hash.hash_line(hc, resultname)
+    for _,entry in ipairs(dt) do
+        hash.hash_line(hc, entry.name)
+        hash.hash_line(hc, entry.checksum)
+    end
+    id = hash.hash_finish(hc)
+
+    e2lib.logf(4, "BUILDID: result=%s buildid=%s outputid=%s", resultname,
+        buildid, id)
+
+    file = e2lib.join(tmpdir, OUTPUTID)
+    rc, re = eio.file_write(file, id .. "\n")
+    if not rc then
+        return false, e:cat(re)
+    end
+
+    rc, re = cache.push_file(cache.cache(), file, server,
+        e2lib.join(resultdir, OUTPUTID), {})
+    if not rc then
+        return false, e:cat(re)
+    end
+
+    if _ids[buildid] ~= id then
+        _ids[buildid] = id
+        _generation = _generation + 1
+    end
+
+    return true
+end
+
+--- Number of output digests recorded or changed in this run. BuildIDs
+-- calculated with an earlier generation may be outdated.
+-- @return Generation number.
+function outputid.generation()
+    return _generation
+end
+
+return strict.lock(outputid)
+
+-- vim:sw=4:sts=4:et:
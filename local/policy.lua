@@ -91,6 +91,32 @@ local function buildid_buildid(buildid)
     return buildid
 end
 
+--- Get a random identifier, derived from a seed and 16 bytes of entropy.
+-- @param seed Seed string.
+-- @return Identifier string.
+local function random_id(seed)
+    local rfile, re, rstr
+    local hc
+
+    rfile, re = eio.fopen("/dev/urandom", "r")
+    if not rfile then
+        e2lib.abort(re)
+    end
+
+    rstr, re = eio.fread(rfile, 16)
+    if not rstr or string.len(rstr) ~= 16 then
+        e2lib.abort("could not get 16 bytes of entropy")
+    end
+
+    eio.fclose(rfile)
+
+    hc = hash.hash_start()
+    hash.hash_append(hc, seed)
+    hash.hash_append(hc, rstr)
+
+    return hash.hash_finish(hc)
+end
+
 local buildid_scratch_cache = {}
 
 --- Get the buildid for a scratch build
@@ -109,38 +135,51 @@ local function buildid_scratch(buildid)
     -- Next best thing is to generate a random buildid. However, since
     -- buildid_scratch() is called multiple times, we need to cache the result
     -- to make the new buildid stable.
+    --
+    -- With --wc-content, buildid_wc() is used instead.
 
     -- calculate buildid only once to make stable.
     if buildid_scratch_cache[buildid] then
         return buildid_scratch_cache[buildid]
     end
 
-    local rfile, re, rstr
-    local hc, newbuildid
+    local newbuildid
 
-    rfile, re = eio.fopen("/dev/urandom", "r")
-    if not rfile then
-        e2lib.abort(re)
-    end
+    newbuildid = "scratch-" .. random_id(buildid)
+    buildid_scratch_cache[buildid] = newbuildid
 
-    rstr, re = eio.fread(rfile, 16)
-    if not rstr or string.len(rstr) ~= 16 then
-        e2lib.abort("could not get 16 bytes of entropy")
-    end
+    e2lib.logf(4, "BUILDID: buildid=%s buildid_scratch=%s", buildid, newbuildid)
 
-    eio.fclose(rfile)
+    return buildid_scratch_cache[buildid]
+end
 
-    hc = hash.hash_start()
-    hash.hash_append(hc, buildid)
-    hash.hash_append(hc, rstr)
+--- Get the buildid for a working-copy build with --wc-content. The sourceids
+-- are calculated from the contents of the working copies, so the buildid
+-- identifies the result as it does in tag mode and results are reused until
+-- the working copies change.
+-- @param buildid the buildid
+-- @return the buildid
+local function buildid_wc(buildid)
+    return "wc-" .. buildid
+end
 
-    newbuildid = hash.hash_finish(hc)
-    newbuildid = "scratch-" .. newbuildid
-    buildid_scratch_cache[buildid] = newbuildid
+local scratch_sourceid_cache = {}
 
-    e2lib.logf(4, "BUILDID: buildid=%s buildid_scratch=%s", buildid, newbuildid)
+--- Get a sourceid for a source that can not calculate one from the contents
+-- of its working copy. The sourceid is random and stable for the run, results
+-- built from the source are never reused.
+-- @param sourcename Source name.
+-- @return Sourceid string.
+function policy.scratch_sourceid(sourcename)
+    assertIsStringN(sourcename)
 
-    return buildid_scratch_cache[buildid]
+    if not scratch_sourceid_cache[sourcename] then
+        scratch_sourceid_cache[sourcename] = random_id(sourcename)
+        e2lib.logf(4, "BUILDID: source=%s scratch sourceid=%s", sourcename,
+            scratch_sourceid_cache[sourcename])
+    end
+
+    return scratch_sourceid_cache[sourcename]
 end
 
 --- Initialize policy module.
@@ -200,6 +239,10 @@ function policy.register_commandline_options()
     Perform all checks to make sure that a build is
     reproducible except checking for remote resources
     Enabled by default in 'release' mode.]])
+    e2option.flag("wc-content",[[
+    Calculate buildids in 'working-copy' mode from the
+    contents of the working copies and skip results
+    that were built from unchanged working copies]])
 end
 
 --- Handle overall build modes.
@@ -294,7 +337,11 @@ function policy.default_build_mode(mode)
         build_mode.deploy = false
     elseif mode == "working-copy" then
         build_mode.source_set = source_set_working_copy
-        build_mode.buildid = buildid_scratch
+        if policy.opts.wc_content() then
+            build_mode.buildid = buildid_wc
+        else
+            build_mode.buildid = buildid_scratch
+        end
         build_mode.storage = storage_local
         build_mode.deploy = false
     else
@@ -320,6 +367,12 @@ function policy.opts.check_remote()
     return e2option.opts['check-remote'] or false
 end
 
+--- Query the 'wc-content' flag
+-- @return true or false
+function policy.opts.wc_content()
+    return e2option.opts['wc-content'] or false
+end
+
 --- Query build-mode option
 -- @return one of "tag", "release", "branch", "working-copy"
 function policy.opts.build_mode()
@@ -55,6 +55,25 @@ function project.register_load_project_config(func)
     return true
 end
 
+--- Convert a size like "5G" to bytes. The suffixes k, M, G and T are powers
+-- of 1000, with an additional "i" powers of 1024, as with ccache.
+-- @param size Size string.
+-- @return Number of bytes, or false if the string is not a size.
+local function size_bytes(size)
+    local num, unit, bin, exp
+
+    num, unit, bin = size:match("^(%d+%.?%d*)([kMGT]?)(i?)$")
+    if not num then
+        return false
+    end
+
+    exp = ({ [""] = 0, k = 1, M = 2, G = 3, T = 4 })[unit]
+    if bin == "i" then
+        return tonumber(num) * 1024^exp
+    end
+    return tonumber(num) * 1000^exp
+end
+
 --- Main e2project config check and init callback.
 -- @param prj e2project table.
 -- @return True on success, false on error.
@@ -64,7 +83,9 @@ local function load_prj_cfg(prj)
 
     rc, re = e2lib.vrfy_dict_exp_keys(prj, "e2project",
         { "name", "release_id", "deploy_results",
-        "default_results", "chroot_arch", "checksums" })
+        "default_results", "chroot_arch", "checksums", "result_format",
+        "result_delta", "compiler_cache", "early_cutoff", "source_cache",
+        "readonly_deps", "tmpfs_chroot" })
     if not rc then
         return false, re
     end
@@ -148,6 +169,167 @@ local function load_prj_cfg(prj)
         return false, err.new("at least one checksum algorithm is required")
     end
 
+    -- result_format
+    if prj.result_format == nil then
+        prj.result_format = "tar"
+    end
+
+    if prj.result_format ~= "tar" and prj.result_format ~= "tar.zst" and
+        prj.result_format ~= "objects" then
+        return false, err.new("result_format is set to an unknown format: %s",
+            tostring(prj.result_format))
+    end
+
+    -- result_delta
+    if prj.result_delta == nil then
+        prj.result_delta = {}
+    end
+
+    if type(prj.result_delta) ~= "table" then
+        return false, err.new("e2project.result_delta is not a table")
+    end
+
+    rc, re = e2lib.vrfy_dict_exp_keys(prj.result_delta,
+        "e2project.result_delta", { "enable", "base" })
+    if not rc then
+        return false, re
+    end
+
+    if prj.result_delta.enable == nil then
+        prj.result_delta.enable = false
+    elseif type(prj.result_delta.enable) ~= "boolean" then
+        return false, err.new("e2project.result_delta.enable is not a boolean")
+    end
+
+    if prj.result_delta.base == nil then
+        prj.result_delta.base = {}
+    elseif type(prj.result_delta.base) ~= "table" then
+        return false, err.new("e2project.result_delta.base is not a table")
+    end
+
+    for resultname, buildid in pairs(prj.result_delta.base) do
+        if type(resultname) ~= "string" or type(buildid) ~= "string" or
+            not buildid:match("^" .. string.rep("%x", 40) .. "$") then
+            return false, err.new("e2project.result_delta.base: "..
+                "expected result name and BuildID, got %s = %s",
+                tostring(resultname), tostring(buildid))
+        end
+    end
+
+    -- compiler_cache
+    if prj.compiler_cache == nil then
+        prj.compiler_cache = {}
+    end
+
+    if type(prj.compiler_cache) ~= "table" then
+        return false, err.new("e2project.compiler_cache is not a table")
+    end
+
+    rc, re = e2lib.vrfy_dict_exp_keys(prj.compiler_cache,
+        "e2project.compiler_cache", { "enable", "max_size" })
+    if not rc then
+        return false, re
+    end
+
+    if prj.compiler_cache.enable == nil then
+        prj.compiler_cache.enable = false
+    elseif type(prj.compiler_cache.enable) ~= "boolean" then
+        return false,
+            err.new("e2project.compiler_cache.enable is not a boolean")
+    end
+
+    if prj.compiler_cache.max_size == nil then
+        prj.compiler_cache.max_size = false
+    elseif type(prj.compiler_cache.max_size) ~= "string" or
+        not prj.compiler_cache.max_size:match("^%d+%.?%d*[kMGT]?i?$") then
+        return false, err.new("e2project.compiler_cache.max_size is not "..
+            "a size like \"5G\"")
+    end
+
+    -- source_cache
+    if prj.source_cache == nil then
+        prj.source_cache = {}
+    end
+
+    if type(prj.source_cache) ~= "table" then
+        return false, err.new("e2project.source_cache is not a table")
+    end
+
+    rc, re = e2lib.vrfy_dict_exp_keys(prj.source_cache,
+        "e2project.source_cache", { "enable", "max_size" })
+    if not rc then
+        return false, re
+    end
+
+    if prj.source_cache.enable == nil then
+        prj.source_cache.enable = false
+    elseif type(prj.source_cache.enable) ~= "boolean" then
+        return false,
+            err.new("e2project.source_cache.enable is not a boolean")
+    end
+
+    if prj.source_cache.max_size == nil then
+        prj.source_cache.max_size = "5G"
+    end
+    if type(prj.source_cache.max_size) ~= "string" or
+        not size_bytes(prj.source_cache.max_size) then
+        return false, err.new("e2project.source_cache.max_size is not "..
+            "a size like \"5G\"")
+    end
+
+    -- early_cutoff
+    if prj.early_cutoff == nil then
+        prj.early_cutoff = false
+    elseif type(prj.early_cutoff) ~= "boolean" then
+        return false, err.new("e2project.early_cutoff is not a boolean")
+    end
+
+    -- readonly_deps
+    if prj.readonly_deps == nil then
+        prj.readonly_deps = false
+    elseif type(prj.readonly_deps) ~= "boolean" then
+        return false, err.new("e2project.readonly_deps is not a boolean")
+    end
+
+    -- tmpfs_chroot
+    if prj.tmpfs_chroot == nil then
+        prj.tmpfs_chroot = {}
+    end
+
+    if type(prj.tmpfs_chroot) ~= "table" then
+        return false, err.new("e2project.tmpfs_chroot is not a table")
+    end
+
+    rc, re = e2lib.vrfy_dict_exp_keys(prj.tmpfs_chroot,
+        "e2project.tmpfs_chroot", { "enable", "size", "budget" })
+    if not rc then
+        return false, re
+    end
+
+    if prj.tmpfs_chroot.enable == nil then
+        prj.tmpfs_chroot.enable = false
+    elseif type(prj.tmpfs_chroot.enable) ~= "boolean" then
+        return false,
+            err.new("e2project.tmpfs_chroot.enable is not a boolean")
+    end
+
+    if prj.tmpfs_chroot.size == nil then
+        prj.tmpfs_chroot.size = "4G"
+    end
+    if type(prj.tmpfs_chroot.size) ~= "string" or
+        not size_bytes(prj.tmpfs_chroot.size) then
+        return false, err.new("e2project.tmpfs_chroot.size is not "..
+            "a size like \"4G\"")
+    end
+
+    if prj.tmpfs_chroot.budget == nil then
+        prj.tmpfs_chroot.budget = false
+    elseif type(prj.tmpfs_chroot.budget) ~= "string" or
+        not size_bytes(prj.tmpfs_chroot.budget) then
+        return false, err.new("e2project.tmpfs_chroot.budget is not "..
+            "a size like \"16G\"")
+    end
+
     _prj = prj
     return true
 end
@@ -197,26 +379,36 @@ function project.load_project_config()
 end
 
 --- Checks project information for consistancy once results are loaded.
+-- @param lazy Results are loaded on demand, do not load the default results.
 -- @return True on success, false on error.
 -- @return Error object on failure.
-function project.verify_project_config()
+function project.verify_project_config(lazy)
     local rc, re, e
     e = err.new("error in project configuration")
 
     for r in project.default_results_iter() do
-        if not result.results[r] then
+        if not result.exists(r) then
             e:append("default_results: No such result: %s", r)
         end
     end
     for r in project.deploy_results_iter() do
-        if not result.results[r] then
+        if not result.exists(r) then
             e:append("deploy_results: No such result: %s", r)
         end
     end
+    for r,_ in pairs(_prj.result_delta.base) do
+        if not result.exists(r) then
+            e:append("result_delta.base: No such result: %s", r)
+        end
+    end
     if e:getcount() > 1 then
         return false, e
     end
 
+    if lazy then
+        return true
+    end
+
     rc, re = e2tool.dsort()
     if not rc then
         return false, e:cat(re)
@@ -302,6 +494,93 @@ function project.checksums_sha256()
     return _prj.checksums.sha256
 end
 
+--- Get the archive format new results are stored in.
+-- @return Result format as a string, "tar", "tar.zst" or "objects".
+function project.result_format()
+    assert(type(_prj.result_format) == "string")
+    return _prj.result_format
+end
+
+--- Whether results are stored as a delta against an earlier result.
+-- @return True or false.
+function project.result_delta()
+    assertIsBoolean(_prj.result_delta.enable)
+    return _prj.result_delta.enable
+end
+
+--- Get the configured delta base BuildID of a result.
+-- @param resultname Result name.
+-- @return BuildID or false if none is configured.
+function project.result_delta_base(resultname)
+    assertIsStringN(resultname)
+    return _prj.result_delta.base[resultname] or false
+end
+
+--- Whether results depend on the output of their dependencies instead of
+-- their BuildIDs, see local.outputid.
+-- @return True or false.
+function project.early_cutoff()
+    assertIsBoolean(_prj.early_cutoff)
+    return _prj.early_cutoff
+end
+
+--- Whether dependencies are bind mounted read-only into the chroot from
+-- the source cache instead of being unpacked into every build.
+-- @return True or false.
+function project.readonly_deps()
+    assertIsBoolean(_prj.readonly_deps)
+    return _prj.readonly_deps
+end
+
+--- Whether results are built with the compiler cache.
+-- @return True or false.
+function project.compiler_cache()
+    assertIsBoolean(_prj.compiler_cache.enable)
+    return _prj.compiler_cache.enable
+end
+
+--- Get the size limit of the compiler cache.
+-- @return Size as a string understood by ccache, or false for the default.
+function project.compiler_cache_max_size()
+    return _prj.compiler_cache.max_size
+end
+
+--- Whether prepared sources are kept in the source cache, see
+-- local.srccache.
+-- @return True or false.
+function project.source_cache()
+    assertIsBoolean(_prj.source_cache.enable)
+    return _prj.source_cache.enable
+end
+
+--- Get the size limit of the source cache.
+-- @return Size in bytes.
+function project.source_cache_max_size()
+    return size_bytes(_prj.source_cache.max_size)
+end
+
+--- Whether chroots are set up on a tmpfs, see local.tmpfs.
+-- @return True or false.
+function project.tmpfs_chroot()
+    assertIsBoolean(_prj.tmpfs_chroot.enable)
+    return _prj.tmpfs_chroot.enable
+end
+
+--- Get the size of a tmpfs chroot.
+-- @return Size in bytes.
+function project.tmpfs_chroot_size()
+    return math.floor(size_bytes(_prj.tmpfs_chroot.size))
+end
+
+--- Get the memory budget of all tmpfs chroots on the host.
+-- @return Size in bytes, or false for the default.
+function project.tmpfs_chroot_budget()
+    if not _prj.tmpfs_chroot.budget then
+        return false
+    end
+    return size_bytes(_prj.tmpfs_chroot.budget)
+end
+
 --- Calculate the Project ID. The Project ID consists of files in proj/init
 -- as well as some keys from proj/config and buildconfig. Returns a cached
 -- value after the first call.
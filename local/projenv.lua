@@ -192,7 +192,7 @@ function projenv.verify_result_envs()
 
     -- check for environment for non-existent results
     for resultname in pairs(_result_env) do
-        if not result.results[resultname] then
+        if not result.exists(resultname) then
             e:append("found environment for unknown result: %s",
                 resultname)
         end
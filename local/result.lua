@@ -25,12 +25,15 @@ local buildconfig = require("buildconfig")
 local cache = require("cache")
 local chroot = require("chroot")
 local class = require("class")
+local configcache = require("configcache")
 local e2build = require("e2build")
 local e2lib = require("e2lib")
 local e2tool = require("e2tool")
 local environment = require("environment")
 local err = require("err")
 local hash = require("hash")
+local outputid = require("outputid")
+local policy = require("policy")
 local project = require("project")
 local projenv = require("projenv")
 local sl = require("sl")
@@ -41,8 +44,12 @@ local strict = require("strict")
 result.results = {}
 
 --- Array holding all results objects in alphabetical order.
+-- Empty if results are loaded on demand.
 result.results_sorted = {}
 
+--- Results are loaded on first access, see load_result_configs().
+local _lazy = false
+
 --- Vector of result type detector functions.
 local type_detection_fns = {}
 
@@ -134,6 +141,27 @@ function result.basic_result:chroot_list()
         self._type, self._name))
 end
 
+--- Whether the result may be built with the compiler cache.
+-- @return True or false.
+function result.basic_result:compiler_cache()
+    error(err.new("called compiler_cache() of result base class, type %s name %s",
+        self._type, self._name))
+end
+
+--- Whether the dependencies of the result may be bind mounted read-only.
+-- @return True or false.
+function result.basic_result:readonly_deps()
+    error(err.new("called readonly_deps() of result base class, type %s name %s",
+        self._type, self._name))
+end
+
+--- Whether the chroot of the result may be set up on a tmpfs.
+-- @return True or false.
+function result.basic_result:tmpfs_chroot()
+    error(err.new("called tmpfs_chroot() of result base class, type %s name %s",
+        self._type, self._name))
+end
+
 --- Return locked build_config table
 -- @return build_config table (locked) or false on error
 -- @return error object.
@@ -192,8 +220,12 @@ function result.result_class:initialize(rawres)
 
     self._depends_list = sl.sl:new()
     self._buildid = false
+    self._outputid_generation = 0
     self._sources_list = sl.sl:new()
     self._chroot_list = sl.sl:new()
+    self._compiler_cache = true
+    self._readonly_deps = true
+    self._tmpfs_chroot = true
     self._env = environment.new()
     self._build_process = false
 
@@ -202,10 +234,13 @@ function result.result_class:initialize(rawres)
 
     rc, re = e2lib.vrfy_dict_exp_keys(rawres, "e2result config", {
         "chroot",
+        "compiler_cache",
         "depends",
         "env",
         "name",
+        "readonly_deps",
         "sources",
+        "tmpfs_chroot",
         "type",
     })
     if not rc then
@@ -287,6 +322,30 @@ function result.result_class:initialize(rawres)
         end
     end
 
+    if rawres.compiler_cache ~= nil then
+        if type(rawres.compiler_cache) ~= "boolean" then
+            e:append("compiler_cache attribute is not a boolean")
+        else
+            self._compiler_cache = rawres.compiler_cache
+        end
+    end
+
+    if rawres.readonly_deps ~= nil then
+        if type(rawres.readonly_deps) ~= "boolean" then
+            e:append("readonly_deps attribute is not a boolean")
+        else
+            self._readonly_deps = rawres.readonly_deps
+        end
+    end
+
+    if rawres.tmpfs_chroot ~= nil then
+        if type(rawres.tmpfs_chroot) ~= "boolean" then
+            e:append("tmpfs_chroot attribute is not a boolean")
+        else
+            self._tmpfs_chroot = rawres.tmpfs_chroot
+        end
+    end
+
     if rawres.env and type(rawres.env) ~= "table" then
         e:append("result has invalid `env' attribute")
     else
@@ -356,6 +415,21 @@ function result.result_class:chroot_list()
     return self._chroot_list
 end
 
+---
+function result.result_class:compiler_cache()
+    return self._compiler_cache
+end
+
+---
+function result.result_class:readonly_deps()
+    return self._readonly_deps
+end
+
+---
+function result.result_class:tmpfs_chroot()
+    return self._tmpfs_chroot
+end
+
 ---
 function result.result_class:build_config()
     local bc, tmpdir, builddir
@@ -370,11 +444,18 @@ function result.result_class:build_config()
     bc.c = e2lib.join(bc.base, "chroot")
     bc.chroot_marker = e2lib.join(bc.base, "e2factory-chroot")
     bc.chroot_lock = e2lib.join(bc.base, "e2factory-chroot-lock")
+    bc.binds_file = e2lib.join(bc.base, "e2factory-binds")
+    bc.steps_file = e2lib.join(bc.base, "e2factory-steps")
+    bc.ccache_store = e2lib.join(tmpdir, "ccache")
+    bc.srccache_store = e2lib.join(tmpdir, "sources")
+    bc.tmpfs_lock = e2lib.join(e2lib.globals.tmpdir, "e2factory-tmpfs.lock")
     bc.T = e2lib.join(bc.c, builddir)
     bc.Tc = e2lib.join("/", builddir)
     bc.r = self:get_name()
     bc.chroot_call_prefix = project.chroot_call_prefix()
     bc.buildlog = string.format("%s/log/build.%s.log", e2tool.root(), self:get_name())
+    bc.resourcelog = string.format("%s/log/resources.%s", e2tool.root(),
+        self:get_name())
     bc.scriptdir = "script"
     bc.build_driver_file = "build-driver"
     bc.buildrc_file = "buildrc"
@@ -436,13 +517,13 @@ end
 function result.result_class:buildid(rbs)
     assertIsTable(rbs)
 
-    local e, rc, re, hc, id
+    local rc, re, hc, id
 
-    if self._buildid then
+    if self._buildid and self._outputid_generation == outputid.generation()
+        then
         return rbs:build_mode().buildid(self._buildid)
     end
 
-    e = err.new("error calculating BuildID for result: %s", self:get_name())
     hc = hash.hash_start()
 
     -- basic_result
@@ -461,6 +542,11 @@ function result.result_class:buildid(rbs)
             return false, re
         end
 
+        if id == "working-copy" and policy.opts.wc_content() then
+            -- source can not calculate a sourceid from its working copy
+            id = policy.scratch_sourceid(sourcename)
+        end
+
         hash.hash_append(hc, id)
     end
 
@@ -468,7 +554,8 @@ function result.result_class:buildid(rbs)
     for groupname in self:chroot_list():iter() do
         id, re = chroot.groups_byname[groupname]:chrootgroupid()
         if not id then
-            return false, e:cat(re)
+            return false, err.new("error calculating BuildID for result: %s",
+                self:get_name()):cat(re)
         end
         hash.hash_append(hc, id)
     end
@@ -496,17 +583,29 @@ function result.result_class:buildid(rbs)
         if not id then
             return false, re
         end
+        if project.early_cutoff() then
+            local oid
+
+            oid, re = outputid.lookup(depname, dep_rbs, id)
+            if re then
+                return false, re
+            end
+            -- a rebuild with identical output keeps this buildid
+            id = oid or id
+        end
         hash.hash_append(hc, id)
     end
 
     -- project
     id, re = project.projid()
     if not id then
-        return false, e:cat(re)
+        return false, err.new("error calculating BuildID for result: %s",
+            self:get_name()):cat(re)
     end
     hash.hash_append(hc, id)
 
     self._buildid = hash.hash_finish(hc)
+    self._outputid_generation = outputid.generation()
 
     e2lib.logf(4, "BUILDID: result=%s buildid=%s", self._name, self._buildid)
 
@@ -554,31 +653,41 @@ end
 -- @return Error object on failure.
 local function gather_result_paths(basedir, results)
     local rc, re
-    local currdir, resdir, resconfig, s
-
+    local currdir, entries, links, configs
     results = results or {}
+
+    -- the directory tells the entry types, only links need a stat
     currdir = e2tool.resultdir(basedir, e2tool.root())
-    for entry, re in e2lib.directory(currdir) do
+    entries = {}
+    links = {}
+    configs = {}
+    for entry, t in e2lib.readdir(currdir, false, true) do
         if not entry then
-            return false, re
+            return false, t
         end
 
         if basedir then
             entry = e2lib.join(basedir, entry)
         end
 
-        resdir = e2tool.resultdir(entry, e2tool.root())
-        resconfig = e2tool.resultconfig(entry, e2tool.root())
-        s = e2lib.stat(resdir)
-        if s.type == "directory" then
-            if e2lib.exists(resconfig) then
-                table.insert(results, entry)
-            else
-                -- try subfolder
-                rc, re = gather_result_paths(entry, results)
-                if not rc then
-                    return false, re
-                end
+        if t == "directory" or t == "symbolic-link" then
+            table.insert(entries, entry)
+            table.insert(configs, e2tool.resultconfig(entry, e2tool.root()))
+            links[#entries] = (t == "symbolic-link")
+        end
+    end
+
+    -- look for the config files of all entries in one call
+    configs = e2lib.statv(configs, true)
+    for i,entry in ipairs(entries) do
+        if configs[i] then
+            table.insert(results, entry)
+        elseif not links[i] or
+            e2lib.isdir(e2tool.resultdir(entry, e2tool.root())) then
+            -- try subfolder
+            rc, re = gather_result_paths(entry, results)
+            if not rc then
+                return false, re
             end
         end
     end
@@ -609,7 +718,7 @@ local function load_rawres(cfg)
     }
 
     path = e2tool.resultconfig(cfg, e2tool.root())
-    rc, re = e2lib.dofile2(path, g)
+    rc, re = configcache.dofile2(path, g, "e2result")
     if not rc then
         return false, e:cat(re)
     end
@@ -639,7 +748,7 @@ local function load_rawres(cfg)
         return false, e
     end
 
-    if result.results[rawres.name] then
+    if rawget(result.results, rawres.name) then
         return false, e:append("duplicate result: %s", rawres.name)
     end
 
@@ -677,13 +786,95 @@ local function load_one_config(cfg)
     return true
 end
 
+--- Load a result and its dependencies on first access of result.results[].
+-- The dependencies are loaded iteratively before any post_initialize() runs,
+-- deep dependency chains do not nest metamethod calls.
+-- Errors are raised, as there is no way to return them from here.
+-- @param results The result.results table.
+-- @param resultname Result name.
+-- @return Result object or nil if there is no such result.
+-- @raise Error object if a result config is invalid.
+local function load_result_on_demand(results, resultname)
+    local rc, re, cfg, rawres, obj, pending, loaded, name
+
+    if type(resultname) ~= "string" then
+        return nil
+    end
+
+    pending = { resultname }
+    loaded = {}
+    while #pending > 0 do
+        name = table.remove(pending)
+        cfg = false
+        if not rawget(results, name) then
+            cfg = e2tool.src_res_lookup(name, e2tool.resultconfig)
+        end
+
+        -- unknown dependencies are reported by post_initialize()
+        if cfg then
+            e2lib.logf(4, "loading result on demand: %s", name)
+
+            rawres, re = load_rawres(cfg)
+            if not rawres then
+                error(re)
+            end
+
+            obj, re = result.instantiate_object(rawres)
+            if not obj then
+                error(re)
+            end
+
+            rawset(results, name, obj)
+            table.insert(loaded, obj)
+
+            for depname in obj:depends_list():iter() do
+                table.insert(pending, depname)
+            end
+        end
+    end
+
+    for _,res in ipairs(loaded) do
+        rc, re = res:post_initialize()
+        if not rc then
+            error(re)
+        end
+    end
+
+    return rawget(results, resultname)
+end
+
+--- Check whether a result exists, without loading it on demand.
+-- @param resultname Result name.
+-- @return True or false.
+function result.exists(resultname)
+    if rawget(result.results, resultname) then
+        return true
+    elseif _lazy then
+        return e2tool.src_res_lookup(resultname, e2tool.resultconfig) ~= false
+    end
+
+    return false
+end
+
 --- Search, load and verify all result configs. On success, all results are
 --available as objects in result.results[].
+-- In lazy mode, no configs are loaded. Results are loaded with their
+-- dependencies on first access of result.results[], and their configs are
+-- found without scanning the result tree. Iterating result.results only
+-- shows the results loaded so far.
+-- @param lazy Load results on first access. Optional.
 -- @return True on success, false on error.
 -- @return Error object on failure.
-function result.load_result_configs()
+function result.load_result_configs(lazy)
     local rc, re, e, configs, res
 
+    if lazy then
+        e2lib.log(3, "loading results on demand")
+        _lazy = true
+        setmetatable(result.results, { __index = load_result_on_demand })
+        return true
+    end
+
     configs, re = gather_result_paths()
     if not configs then
         return false, re
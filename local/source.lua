@@ -21,6 +21,7 @@
 local source = {}
 local cache = require("cache")
 local class = require("class")
+local configcache = require("configcache")
 local e2lib = require("e2lib")
 local e2tool = require("e2tool")
 local environment = require("environment")
@@ -198,31 +199,41 @@ source.sources = {}
 -- @return Error object on failure.
 local function gather_source_paths(basedir, sources)
     local rc, re
-    local currdir, sdir, sconfig, s
+    local currdir, entries, links, configs
     sources = sources or {}
 
+    -- the directory tells the entry types, only links need a stat
     currdir = e2tool.sourcedir(basedir, e2tool.root())
-    for entry, re in e2lib.directory(currdir) do
+    entries = {}
+    links = {}
+    configs = {}
+    for entry, t in e2lib.readdir(currdir, false, true) do
         if not entry then
-            return false, re
+            return false, t
         end
 
         if basedir then
             entry = e2lib.join(basedir, entry)
         end
 
-        sdir = e2tool.sourcedir(entry, e2tool.root())
-        sconfig = e2tool.sourceconfig(entry, e2tool.root())
-        s = e2lib.stat(sdir)
-        if s.type == "directory" then
-            if e2lib.exists(sconfig) then
-                table.insert(sources, entry)
-            else
-                -- try sub directory
-                rc, re = gather_source_paths(entry, sources)
-                if not rc then
-                    return false, re
-                end
+        if t == "directory" or t == "symbolic-link" then
+            table.insert(entries, entry)
+            table.insert(configs, e2tool.sourceconfig(entry, e2tool.root()))
+            links[#entries] = (t == "symbolic-link")
+        end
+    end
+
+    -- look for the config files of all entries in one call
+    configs = e2lib.statv(configs, true)
+    for i,entry in ipairs(entries) do
+        if configs[i] then
+            table.insert(sources, entry)
+        elseif not links[i] or
+            e2lib.isdir(e2tool.sourcedir(entry, e2tool.root())) then
+            -- try sub directory
+            rc, re = gather_source_paths(entry, sources)
+            if not rc then
+                return false, re
             end
         end
     end
@@ -230,98 +241,154 @@ local function gather_source_paths(basedir, sources)
     return sources
 end
 
---- Search, load and verify all source configs. On success, all sources
---available as objects in source.sources[] etc.
--- @return True on success, false on error.
+--- Load, verify and instantiate a source config.
+-- @param cfg Path of the source (ex: group/name).
+-- @return Source object or false on error.
 -- @return Error object on failure.
-function source.load_source_configs()
+local function load_one_source(cfg)
     local rc, re, e
-    local g, rawsrc, loadcnt, configs, path, src
+    local g, rawsrc, loadcnt, path, src
 
     e = err.new("error loading source configuration")
 
-    configs, re = gather_source_paths()
-    if not configs then
+    rc, re = e2tool.verify_src_res_pathname_valid_chars(cfg)
+    if not rc then
+        e:append("invalid source file name: %s", cfg)
+        e:cat(re)
+        return false, e
+    end
+
+    rawsrc = nil
+    loadcnt = 0
+    g = {
+        e2source = function(data) rawsrc = data loadcnt = loadcnt + 1 end,
+        env = projenv.safe_global_res_env_table(),
+        string = e2lib.safe_string_table(),
+    }
+
+    path = e2tool.sourceconfig(cfg, e2tool.root())
+    rc, re = configcache.dofile2(path, g, "e2source")
+    if not rc then
         return false, e:cat(re)
     end
 
-    for _,cfg in ipairs(configs) do
+    if type(rawsrc) ~= "table" then
+        return false, e:append("source %q is missing an e2source table", cfg)
+    end
 
-        if e2lib.signal_received() ~= "" then
-            return false, err.new("shutting down e2factory [src]")
-        end
+    if loadcnt > 1 then
+        return false, e:append("duplicate source config in %q", cfg)
+    end
 
-        rc, re = e2tool.verify_src_res_pathname_valid_chars(cfg)
-        if not rc then
-            e:append("invalid source file name: %s", cfg)
-            e:cat(re)
-            return false, e
-        end
+    if not rawsrc.name then
+        rawsrc.name = e2tool.src_res_path_to_name(cfg)
+    end
 
-        rawsrc = nil
-        loadcnt = 0
-        g = {
-            e2source = function(data) rawsrc = data loadcnt = loadcnt + 1 end,
-            env = projenv.safe_global_res_env_table(),
-            string = e2lib.safe_string_table(),
-        }
-
-        path = e2tool.sourceconfig(cfg, e2tool.root())
-        rc, re = e2lib.dofile2(path, g)
-        if not rc then
-            return false, e:cat(re)
-        end
+    if rawsrc.name ~= e2tool.src_res_path_to_name(cfg) then
+        return false, e:append(
+            "source name %q must match source directory name %q",
+            rawsrc.name, e2tool.src_res_path_to_name(cfg))
+    end
 
-        if type(rawsrc) ~= "table" then
-            return false, e:append("source %q is missing an e2source table", cfg)
-        end
+    rc, re = e2tool.verify_src_res_name_valid_chars(rawsrc.name)
+    if not rc then
+        e:append("invalid source name: %s", rawsrc.name)
+        e:cat(re)
+        return false, e
+    end
 
-        if loadcnt > 1 then
-            return false, e:append("duplicate source config in %q", cfg)
-        end
+    if rawget(source.sources, rawsrc.name) then
+        return false, e:append("duplicate source: %s", rawsrc.name)
+    end
 
-        if not rawsrc.name then
-            rawsrc.name = e2tool.src_res_path_to_name(cfg)
-        end
+    -- source with no type field is treated as file source
+    if not rawsrc.type then
+        rawsrc.type = "files"
+    end
 
-        if rawsrc.name ~= e2tool.src_res_path_to_name(cfg) then
-            return false, e:append(
-                "source name %q must match source directory name %q",
-                rawsrc.name, e2tool.src_res_path_to_name(cfg))
-        end
+    if not source_types[rawsrc.type] then
+        return false,
+            e:append("don't know how to handle %q source", rawsrc.type)
+    end
 
-        rc, re = e2tool.verify_src_res_name_valid_chars(rawsrc.name)
-        if not rc then
-            e:append("invalid source name: %s", rawsrc.name)
-            e:cat(re)
-            return false, e
-        end
+    src = source_types[rawsrc.type]
 
-        if source.sources[rawsrc.name] then
-            return false, e:append("duplicate source: %s", rawsrc.name)
-        end
+    -- src:new(rawsrc)
+    rc, re = e2lib.trycall(src.new, src, rawsrc)
+    if not rc then
+        e = err.new("error in source %q", rawsrc.name)
+        return false, e:cat(re)
+    end
 
-        -- source with no type field is treated as file source
-        if not rawsrc.type then
-            rawsrc.type = "files"
-        end
+    src = re
+    assert(type(src) == "table")
 
-        if not source_types[rawsrc.type] then
-            return false,
-                e:append("don't know how to handle %q source", rawsrc.type)
-        end
+    return src
+end
+
+--- Load a source on first access of source.sources[].
+-- Errors are raised, as there is no way to return them from here.
+-- @param sources The source.sources table.
+-- @param sourcename Source name.
+-- @return Source object or nil if there is no such source.
+-- @raise Error object if the source config is invalid.
+local function load_source_on_demand(sources, sourcename)
+    local re, cfg, src
 
-        src = source_types[rawsrc.type]
+    if type(sourcename) ~= "string" then
+        return nil
+    end
+
+    cfg = e2tool.src_res_lookup(sourcename, e2tool.sourceconfig)
+    if not cfg then
+        return nil
+    end
 
-        -- src:new(rawsrc)
-        rc, re = e2lib.trycall(src.new, src, rawsrc)
-        if not rc then
-            e = err.new("error in source %q", rawsrc.name)
-            return false, e:cat(re)
+    e2lib.logf(4, "loading source on demand: %s", sourcename)
+
+    src, re = load_one_source(cfg)
+    if not src then
+        error(re)
+    end
+
+    rawset(sources, sourcename, src)
+
+    return src
+end
+
+--- Search, load and verify all source configs. On success, all sources
+--available as objects in source.sources[] etc.
+-- In lazy mode, no configs are loaded. Sources are loaded on first access
+-- of source.sources[], see result.load_result_configs().
+-- @param lazy Load sources on first access. Optional.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function source.load_source_configs(lazy)
+    local re, e, configs, src
+
+    if lazy then
+        setmetatable(source.sources, { __index = load_source_on_demand })
+        return true
+    end
+
+    e = err.new("error loading source configuration")
+
+    configs, re = gather_source_paths()
+    if not configs then
+        return false, e:cat(re)
+    end
+
+    for _,cfg in ipairs(configs) do
+
+        if e2lib.signal_received() ~= "" then
+            return false, err.new("shutting down e2factory [src]")
+        end
+
+        src, re = load_one_source(cfg)
+        if not src then
+            return false, re
         end
 
-        src = re
-        assert(type(src) == "table")
         source.sources[src:get_name()] = src
     end
 
@@ -0,0 +1,377 @@
+--- Cache of prepared source trees, for e2project source_cache. A source is
+-- prepared once per sourceid into the cache and copied from there into the
+-- build directory of every result using it. Copies are reflinks where the
+-- file system supports them. Hardlinks are not used, as build scripts may
+-- modify their sources in place and the build directory is chowned before
+-- the build. The least recently used trees are removed when the cache grows
+-- beyond its size limit. Sources in working-copy mode are not cached.
+-- collect_project keeps the source and chroot group fragments of the
+-- exported project in the same cache, e2project readonly_deps the unpacked
+-- dependencies. Entries bind mounted into a chroot are never removed.
+-- @module local.srccache
+
+-- Copyright (C) 2007-2016 emlix GmbH, see file AUTHORS
+--
+-- This file is part of e2factory, the emlix embedded build system.
+-- For more information see http://www.e2factory.org
+--
+-- e2factory is a registered trademark of emlix GmbH.
+--
+-- e2factory is free software: you can redistribute it and/or modify it under
+-- the terms of the GNU General Public License as published by the
+-- Free Software Foundation, either version 3 of the License, or (at your
+-- option) any later version.
+--
+-- This program is distributed in the hope that it will be useful, but WITHOUT
+-- ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+-- FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+-- more details.
+
+local srccache = {}
+local e2lib = require("e2lib")
+local eio = require("eio")
+local err = require("err")
+local project = require("project")
+local strict = require("strict")
+
+-- Every cache entry is a directory named by the sourceid, holding the
+-- prepared "tree" and a "size" file with the size of the tree in bytes.
+-- The modification time of the size file is the time of the last use.
+
+local _hits = 0
+local _misses = 0
+
+--- Sum up the sizes of all files in a tree.
+-- @param path Directory path.
+-- @return Size in bytes, or false on error.
+-- @return Error object on failure.
+local function tree_size(path)
+    local size, paths, sbv
+
+    size = 0
+    paths = {}
+    for name, t in e2lib.readdir(path, true) do
+        if not name then
+            return false, t
+        end
+
+        if t == "directory" then
+            local s, re = tree_size(e2lib.join(path, name))
+            if not s then
+                return false, re
+            end
+            size = size + s
+        else
+            table.insert(paths, e2lib.join(path, name))
+        end
+    end
+
+    sbv = e2lib.statv(paths, false)
+    for i,_ in ipairs(paths) do
+        if sbv[i] then
+            size = size + sbv[i].size
+        end
+    end
+
+    return size
+end
+
+--- Find the entries bind mounted into chroots. The chroots of all projects
+-- of the user are next to the cache, each with its bind list in
+-- <project>/<result>/e2factory-binds.
+-- @param store Cache directory.
+-- @return Table of the names of the entries in use, or false on error.
+-- @return Error object on failure.
+local function bound_entries(store)
+    local re, prefix, top, bound
+
+    -- add the entries of the sources in one bind list
+    local function add_bound(binds)
+        local file, line, src
+
+        file, re = eio.fopen(binds, "r")
+        if not file then
+            return false, re
+        end
+
+        while true do
+            line, re = eio.readline(file)
+            if not line then
+                eio.fclose(file)
+                return false, re
+            elseif line == "" then
+                break
+            end
+
+            src = string.match(line, "^([^\t]*)\t")
+            if src and string.sub(src, 1, #prefix) == prefix then
+                bound[string.match(src, "^[^/]+", #prefix + 1)] = true
+            end
+        end
+
+        return eio.fclose(file)
+    end
+
+    bound = {}
+    prefix = store .. "/"
+    top = e2lib.dirname(store)
+    for projectname, t in e2lib.readdir(top) do
+        if not projectname then
+            return false, t
+        end
+
+        if t == "directory" and projectname ~= e2lib.basename(store) then
+            local projectdir = e2lib.join(top, projectname)
+
+            for resultname, rt in e2lib.readdir(projectdir) do
+                if not resultname then
+                    return false, rt
+                end
+
+                local binds = e2lib.join(projectdir, resultname,
+                    "e2factory-binds")
+                if rt == "directory" and e2lib.isfile(binds) then
+                    local rc, re = add_bound(binds)
+                    if not rc then
+                        return false, re
+                    end
+                end
+            end
+        end
+    end
+
+    return bound
+end
+
+--- Remove the least recently used entries until the cache fits into its
+-- size limit. Entries bind mounted into a chroot are kept, they are in use
+-- by a build or kept for the playground and e2-build --resume.
+-- @param store Cache directory.
+-- @param keep Sourceid of an entry that is never removed.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+local function evict(store, keep)
+    local rc, re, entries, total, max, bound
+
+    entries = {}
+    total = 0
+    for name, t in e2lib.readdir(store) do
+        if not name then
+            return false, t
+        end
+
+        if t == "directory" and string.match(name, "^%x+$") then
+            local sizefile, sb, size
+
+            sizefile = e2lib.join(store, name, "size")
+            sb = e2lib.stat(sizefile)
+            size = tonumber(eio.file_read_line(sizefile) or "")
+            if sb and size then
+                table.insert(entries, { name = name, size = size,
+                    mtime = sb.mtime })
+                total = total + size
+            end
+        end
+    end
+
+    table.sort(entries, function(a, b) return a.mtime < b.mtime end)
+
+    max = project.source_cache_max_size()
+    if total <= max then
+        return true
+    end
+
+    bound, re = bound_entries(store)
+    if not bound then
+        return false, re
+    end
+
+    for _,entry in ipairs(entries) do
+        if total <= max then
+            break
+        end
+
+        if entry.name ~= keep and not bound[entry.name] then
+            local path, tmpdir
+
+            e2lib.logf(3, "source cache: removing %s", entry.name)
+
+            -- a renamed entry is never found half removed
+            path = e2lib.join(store, entry.name)
+            tmpdir, re = e2lib.mktempdir(path .. ".XXXXXX")
+            if not tmpdir then
+                return false, re
+            end
+            rc, re = e2lib.rename(path, e2lib.join(tmpdir, "entry"))
+            if not rc then
+                return false, re
+            end
+            e2lib.rmtempdir(tmpdir)
+
+            total = total - entry.size
+        end
+    end
+
+    return true
+end
+
+--- Fill a new cache entry.
+-- @param store Cache directory.
+-- @param key Name of the entry, a hex digest.
+-- @param fill Function filling the tree of the entry, called with the tree
+--             path, returns true or false and an error object.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+local function add(store, key, fill)
+    local rc, re, tmpdir, tree, size
+
+    rc, re = e2lib.mkdir_recursive(store)
+    if not rc then
+        return false, re
+    end
+
+    tmpdir, re = e2lib.mktempdir(e2lib.join(store, key .. ".XXXXXX"))
+    if not tmpdir then
+        return false, re
+    end
+
+    tree = e2lib.join(tmpdir, "tree")
+    rc, re = e2lib.mkdir(tree)
+    if not rc then
+        return false, re
+    end
+
+    rc, re = fill(tree)
+    if not rc then
+        return false, re
+    end
+
+    size, re = tree_size(tree)
+    if not size then
+        return false, re
+    end
+
+    rc, re = eio.file_write(e2lib.join(tmpdir, "size"), size .. "\n")
+    if not rc then
+        return false, re
+    end
+
+    rc, re = e2lib.rename(tmpdir, e2lib.join(store, key))
+    if not rc and not e2lib.exists(e2lib.join(store, key, "size")) then
+        return false, re
+    end
+    -- if another build added the entry in the meantime, use that one
+    e2lib.rmtempdir(tmpdir)
+
+    return evict(store, key)
+end
+
+--- Get the tree of a cache entry, filling a new entry first if there is
+-- none for the key.
+-- @param store Cache directory.
+-- @param key Name of the entry, a hex digest.
+-- @param desc Description of the entry for log messages.
+-- @param fill Function filling the tree of a new entry, called with the
+--             tree path, returns true or false and an error object.
+-- @return Path of the tree, or false on error.
+-- @return Error object on failure.
+function srccache.entry(store, key, desc, fill)
+    assertIsStringN(store)
+    assertStrMatches(key, "^%x+$")
+    assertIsStringN(desc)
+    assertIsFunction(fill)
+
+    local rc, re, entry, sizefile, size
+
+    entry = e2lib.join(store, key)
+    sizefile = e2lib.join(entry, "size")
+
+    size = eio.file_read_line(sizefile)
+    if size then
+        _hits = _hits + 1
+        e2lib.logf(3, "source cache: %s: using %s", desc, key)
+
+        -- mark as recently used
+        rc, re = eio.file_write(sizefile, size .. "\n")
+        if not rc then
+            return false, re
+        end
+    else
+        _misses = _misses + 1
+        e2lib.logf(3, "source cache: %s: adding %s", desc, key)
+
+        rc, re = add(store, key, fill)
+        if not rc then
+            return false, err.new("adding %s to the source cache failed",
+                desc):cat(re)
+        end
+    end
+
+    return e2lib.join(entry, "tree")
+end
+
+--- Copy a tree from the cache into a directory, filling a new cache entry
+-- first if there is none for the key.
+-- @param store Cache directory.
+-- @param key Name of the entry, a hex digest.
+-- @param desc Description of the entry for log messages.
+-- @param fill Function filling the tree of a new entry, called with the
+--             tree path, returns true or false and an error object.
+-- @param destdir Destination directory.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function srccache.provide(store, key, desc, fill, destdir)
+    assertIsStringN(destdir)
+
+    local rc, re, tree
+
+    tree, re = srccache.entry(store, key, desc, fill)
+    if not tree then
+        return false, re
+    end
+
+    rc, re = e2lib.mkdir_recursive(destdir)
+    if not rc then
+        return false, re
+    end
+
+    return e2lib.call_tool_argv("cp", { "-a", "--reflink=auto",
+        tree .. "/.", destdir })
+end
+
+--- Prepare a source in the build directory of a result, through the cache
+-- if it is enabled.
+-- @param res Result object.
+-- @param src Source object.
+-- @param sourceset Source set.
+-- @param destdir Directory the source is prepared in.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function srccache.prepare_source(res, src, sourceset, destdir)
+    local sourceid, re
+
+    if not project.source_cache() or sourceset == "working-copy" then
+        return src:prepare_source(sourceset, destdir)
+    end
+
+    sourceid, re = src:sourceid(sourceset)
+    if not sourceid then
+        return false, re
+    end
+
+    return srccache.provide(res:build_config().srccache_store, sourceid,
+        src:get_name(),
+        function(tree) return src:prepare_source(sourceset, tree) end,
+        destdir)
+end
+
+--- Log the source cache hits and misses of all builds.
+function srccache.report()
+    if _hits + _misses > 0 then
+        e2lib.logf(2, "source cache: %d hits, %d misses", _hits, _misses)
+    end
+end
+
+return strict.lock(srccache)
+
+-- vim:sw=4:sts=4:et:
@@ -0,0 +1,246 @@
+--- Chroot environments on a tmpfs, for e2project tmpfs_chroot. The chroot
+-- directory of a result is mounted as a tmpfs of a fixed size by e2-su
+-- before the chroot is set up, and unmounted when it is removed. The sizes
+-- of all tmpfs chroots on the host, of all users and projects, are taken
+-- from /proc/mounts and must stay within the memory budget. A chroot not
+-- fitting into the budget is set up on disk as before.
+-- @module local.tmpfs
+
+-- Copyright (C) 2007-2016 emlix GmbH, see file AUTHORS
+--
+-- This file is part of e2factory, the emlix embedded build system.
+-- For more information see http://www.e2factory.org
+--
+-- e2factory is a registered trademark of emlix GmbH.
+--
+-- e2factory is free software: you can redistribute it and/or modify it under
+-- the terms of the GNU General Public License as published by the
+-- Free Software Foundation, either version 3 of the License, or (at your
+-- option) any later version.
+--
+-- This program is distributed in the hope that it will be useful, but WITHOUT
+-- ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+-- FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+-- more details.
+
+local tmpfs = {}
+local e2lib = require("e2lib")
+local e2tool = require("e2tool")
+local eio = require("eio")
+local err = require("err")
+local project = require("project")
+local strict = require("strict")
+
+local _unsupported = false -- e2-su failed to mount a tmpfs before
+
+--- Check whether the chroot of a result is set up on a tmpfs.
+-- @param res Result object.
+-- @return True or false.
+function tmpfs.enabled(res)
+    return project.tmpfs_chroot() and res:tmpfs_chroot()
+end
+
+--- Get the tmpfs mounts of the host.
+-- @return Table mapping mount points to sizes in bytes, or false on error.
+-- @return Error object on failure.
+local function tmpfs_mounts()
+    local re, file, buf, data, mounts
+
+    file, re = eio.fopen("/proc/mounts", "r")
+    if not file then
+        return false, re
+    end
+
+    data = {}
+    repeat
+        buf, re = eio.fread(file, 64*1024)
+        if not buf then
+            eio.fclose(file)
+            return false, re
+        end
+        table.insert(data, buf)
+    until buf == ""
+
+    eio.fclose(file)
+
+    mounts = {}
+    for mnt, opts in string.gmatch(table.concat(data),
+        "%S+ (%S+) tmpfs (%S+)[^\n]*\n") do
+        local size = string.match(opts, "size=(%d+)k")
+        mounts[mnt] = tonumber(size or "0") * 1024
+    end
+
+    return mounts
+end
+
+--- Get the default memory budget, half of the physical memory.
+-- @return Size in bytes, or false on error.
+-- @return Error object on failure.
+local function default_budget()
+    local line, re, kb
+
+    line, re = eio.file_read_line("/proc/meminfo")
+    if not line then
+        return false, re
+    end
+
+    kb = string.match(line, "^MemTotal:%s+(%d+) kB$")
+    if not kb then
+        return false, err.new("unexpected line in /proc/meminfo: %s", line)
+    end
+
+    return tonumber(kb) * 1024 / 2
+end
+
+--- Open the lock file shared by the builds of all users on the host. The
+-- file is created world writable. An existing file is opened read-only,
+-- which is enough to lock it and is not refused for files of other users in
+-- a sticky directory like /tmp.
+-- @param path Path of the lock file.
+-- @return File object, or false on error.
+-- @return Error object on failure.
+local function lock_open(path)
+    local rc, re, file
+
+    if e2lib.exists(path) then
+        return eio.fopen(path, "r")
+    end
+
+    file, re = eio.fopen(path, "w")
+    if not file then
+        -- created by someone else in the meantime
+        return eio.fopen(path, "r")
+    end
+
+    rc, re = e2lib.chmod(path, "666")
+    if not rc then
+        e2lib.logf(3, "tmpfs: %s", re:tostring())
+    end
+
+    return file
+end
+
+--- Mount a tmpfs on the empty chroot directory of a result if the memory
+-- budget allows. Failures are logged, the chroot is then set up on disk.
+-- @param res Result object.
+-- @return True if the tmpfs was mounted, false otherwise.
+function tmpfs.mount(res)
+    local rc, re, bc, size, budget, used, mounts, prefix, mounted, lock
+
+    if _unsupported then
+        return false
+    end
+
+    bc = res:build_config()
+    size = project.tmpfs_chroot_size()
+    budget = project.tmpfs_chroot_budget()
+    if not budget then
+        budget, re = default_budget()
+        if not budget then
+            e2lib.logf(2, "tmpfs: %s", re:tostring())
+            return false
+        end
+    end
+
+    -- concurrent builds on the host take turns checking the budget, the
+    -- lock is released when the file is closed, also by a killed process
+    lock, re = lock_open(bc.tmpfs_lock)
+    if lock then
+        rc, re = eio.flock(lock, true)
+        if not rc then
+            eio.fclose(lock)
+        end
+    end
+    if not lock or not rc then
+        e2lib.logf(2, "tmpfs: %s, building %s on disk", re:tostring(),
+            res:get_name())
+        return false
+    end
+
+    mounted = false
+    mounts, re = tmpfs_mounts()
+    if not mounts then
+        e2lib.logf(2, "tmpfs: %s", re:tostring())
+    else
+        used = 0
+        prefix = e2lib.join(e2lib.globals.tmpdir, "e2factory-")
+        for mnt, mntsize in pairs(mounts) do
+            if string.sub(mnt, 1, #prefix) == prefix and
+                string.match(mnt, "/chroot$") then
+                used = used + mntsize
+            end
+        end
+
+        if used + size > budget then
+            e2lib.logf(2, "tmpfs: memory budget exhausted, building %s on disk",
+                res:get_name())
+        else
+            e2tool.set_umask()
+            rc, re = e2lib.e2_su_2_2({"mount_tmpfs_2_3", bc.base,
+                string.format("%d", size)})
+            e2tool.reset_umask()
+            if rc then
+                e2lib.logf(3, "tmpfs: mounted %s", bc.c)
+                mounted = true
+            else
+                _unsupported = true
+                e2lib.warnf("WOTHER", "e2-su can not mount a tmpfs, "..
+                    "chroots are set up on disk")
+            end
+        end
+    end
+
+    rc, re = eio.fclose(lock)
+    if not rc then
+        e2lib.logf(2, "tmpfs: %s", re:tostring())
+    end
+
+    return mounted
+end
+
+--- Check whether the chroot of a result is mounted as a tmpfs.
+-- @param res Result object.
+-- @return True if it is, false if not or on error.
+-- @return Error object on failure.
+function tmpfs.mounted(res)
+    local re, mounts
+
+    mounts, re = tmpfs_mounts()
+    if not mounts then
+        return false, re
+    end
+
+    return mounts[res:build_config().c] ~= nil
+end
+
+--- Unmount the tmpfs of a chroot if there is one, before removing the
+-- chroot.
+-- @param res Result object.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+function tmpfs.umount(res)
+    local rc, re, bc, mounted
+
+    bc = res:build_config()
+    mounted, re = tmpfs.mounted(res)
+    if re then
+        return false, re
+    end
+
+    if not mounted then
+        return true
+    end
+
+    e2tool.set_umask()
+    rc, re = e2lib.e2_su_2_2({"umount_tmpfs_2_3", bc.base})
+    e2tool.reset_umask()
+    if not rc then
+        return false, err.new("unmounting tmpfs failed: %s", bc.c):cat(re)
+    end
+
+    return true
+end
+
+return strict.lock(tmpfs)
+
+-- vim:sw=4:sts=4:et:
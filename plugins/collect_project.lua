@@ -19,6 +19,7 @@
 -- FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
 -- more details.
 
+local buildconfig = require("buildconfig")
 local cache = require("cache")
 local chroot = require("chroot")
 local class = require("class")
@@ -35,6 +36,7 @@ local projenv = require("projenv")
 local result = require("result")
 local sl = require("sl")
 local source = require("source")
+local srccache = require("srccache")
 local strict = require("strict")
 
 --------------------------------------------------------------------------------
@@ -43,6 +45,37 @@ local _source_to_result_functions = {
     -- type = function()
 }
 
+--- Provide a fragment of the exported project, from the source cache if it
+-- is enabled. Fragments are cached by a digest of the e2factory version, the
+-- fragment kind and the id covering their contents.
+-- @param res Result object.
+-- @param kind Kind of the fragment, "source" or "chroot".
+-- @param id Sourceid or chrootgroupid of the fragment, or false if it can
+--           not be cached.
+-- @param desc Description of the fragment for log messages.
+-- @param fill Function writing the fragment into a directory, called with
+--             the directory path, returns true or false and an error object.
+-- @param destdir Destination directory.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+local function provide_fragment(res, kind, id, desc, fill, destdir)
+    local hc, key
+
+    if not project.source_cache() or not id then
+        return fill(destdir)
+    end
+
+    hc = hash.hash_start()
+    hash.hash_line(hc, buildconfig.VERSIONSTRING)
+    hash.hash_line(hc, "collect_project")
+    hash.hash_line(hc, kind)
+    hash.hash_line(hc, id)
+    key = hash.hash_finish(hc)
+
+    return srccache.provide(res:build_config().srccache_store, key,
+        string.format("collect_project %s %s", kind, desc), fill, destdir)
+end
+
 --- Create Makefile based structure required to build the project
 -- without e2factory
 -- @param self A build_process_class instance
@@ -188,44 +221,63 @@ local function _build_collect_project(self, res, rbs)
         e2lib.logf(3, "chroot group: %s", g)
         local grp = chroot.groups_byname[g]
         local destdir = e2lib.join(bc.T, "project/chroot", g)
-        rc, re = e2lib.mkdir_recursive(destdir)
-        if not rc then
-            return false, e:cat(re)
-        end
+        local chrootgroupid
 
-        out = { "place:\n" }
+        local function export_chroot_group(destdir)
+            local rc, re, out
 
-        for file in grp:file_iter() do
-            local cache_flags = {}
-            rc, re = cache.fetch_file(cache.cache(), file:server(),
-                file:location(), destdir, nil, cache_flags)
-            if not rc then
-                return false, e:cat(re)
-            end
-            if file:sha1() then
-                local checksum_file = string.format(
-                    "%s/%s.sha1", destdir, e2lib.basename(file:location()))
-                local filename = e2lib.basename(file:location())
-                rc, re = eio.file_write(checksum_file,
-                    string.format("%s  %s", file:sha1(), filename))
+            out = { "place:\n" }
+
+            for file in grp:file_iter() do
+                local cache_flags = {}
+                rc, re = cache.fetch_file(cache.cache(), file:server(),
+                    file:location(), destdir, nil, cache_flags)
                 if not rc then
-                    return false, e:cat(re)
+                    return false, re
+                end
+                if file:sha1() then
+                    local checksum_file = string.format(
+                        "%s/%s.sha1", destdir, e2lib.basename(file:location()))
+                    local filename = e2lib.basename(file:location())
+                    rc, re = eio.file_write(checksum_file,
+                        string.format("%s  %s", file:sha1(), filename))
+                    if not rc then
+                        return false, re
+                    end
+                    table.insert(out, string.format("\tsha1sum -c '%s'\n",
+                        e2lib.basename(checksum_file)))
                 end
-                table.insert(out, string.format("\tsha1sum -c '%s'\n",
-                    e2lib.basename(checksum_file)))
+                local tartype
+                tartype, re = e2lib.tartype_by_suffix(file:location())
+                if not tartype then
+                    return false, re
+                end
+                table.insert(out, string.format(
+                    "\te2-su-2.2 extract_tar_2_3 $(chroot_base) \"%s\" '%s'\n",
+                    tartype, e2lib.basename(file:location())))
             end
-            local tartype
-            tartype, re = e2lib.tartype_by_suffix(file:location())
-            if not tartype then
-                return false, e:cat(re)
+
+            local makefile = e2lib.join(destdir, "Makefile")
+            rc, re = eio.file_write(makefile, table.concat(out))
+            if not rc then
+                return false, re
             end
-            table.insert(out, string.format(
-                "\te2-su-2.2 extract_tar_2_3 $(chroot_base) \"%s\" '%s'\n",
-                tartype, e2lib.basename(file:location())))
+
+            return true
         end
 
-        local makefile = e2lib.join(destdir, "Makefile")
-        rc, re = eio.file_write(makefile, table.concat(out))
+        rc, re = e2lib.mkdir_recursive(destdir)
+        if not rc then
+            return false, e:cat(re)
+        end
+
+        chrootgroupid, re = grp:chrootgroupid()
+        if not chrootgroupid then
+            return false, e:cat(re)
+        end
+
+        rc, re = provide_fragment(res, "chroot", chrootgroupid, g,
+            export_chroot_group, destdir)
         if not rc then
             return false, e:cat(re)
         end
@@ -322,6 +374,7 @@ local function _build_collect_project(self, res, rbs)
         local source_set = rbs:build_mode().source_set()
         local src = source.sources[sourcename]
         local source_to_result_fn = _source_to_result_functions[src:get_type()]
+        local sourceid
 
         if not source_to_result_fn then
             return false,
@@ -334,7 +387,18 @@ local function _build_collect_project(self, res, rbs)
             return false, e:cat(re)
         end
 
-        rc, re = source_to_result_fn(src, source_set, destdir)
+        -- working copies have no stable sourceid
+        if source_set ~= "working-copy" then
+            sourceid, re = src:sourceid(source_set)
+            if not sourceid then
+                return false, e:cat(re)
+            end
+        end
+
+        rc, re = provide_fragment(res, "source", sourceid, sourcename,
+            function(destdir)
+                return source_to_result_fn(src, source_set, destdir)
+            end, destdir)
         if not rc then
             return false, e:cat(re)
         end
@@ -353,6 +417,25 @@ local function _build_collect_project(self, res, rbs)
     if not rc then
         return false, e:cat(re)
     end
+    -- write one make target per result, depending on the targets of the
+    -- results it depends on, for make -jN
+    out = {
+        "### generated by e2factory, dependencies between results ###\n",
+        string.format("RESULTS = %s\n", table.concat(tsorted_results, " ")),
+    }
+    for _,resultname in ipairs(tsorted_results) do
+        local prereqs = {}
+        for depname in result.results[resultname]:depends_list():iter() do
+            table.insert(prereqs, " stamp/" .. depname)
+        end
+        table.insert(out, string.format("stamp/%s:%s\n", resultname,
+            table.concat(prereqs)))
+    end
+    rc, re = eio.file_write(e2lib.join(destdir, "resultdeps.mk"),
+        table.concat(out))
+    if not rc then
+        return false, e:cat(re)
+    end
     -- install the global Makefiles
     local server = cache.server_names().dot
     local destdir = e2lib.join(bc.T, "project")
@@ -521,6 +604,18 @@ function collect_project_class:chroot_list()
     return self._stdresult:chroot_list()
 end
 
+function collect_project_class:compiler_cache()
+    return self._stdresult:compiler_cache()
+end
+
+function collect_project_class:readonly_deps()
+    return self._stdresult:readonly_deps()
+end
+
+function collect_project_class:tmpfs_chroot()
+    return self._stdresult:tmpfs_chroot()
+end
+
 function collect_project_class:merged_env()
     return self._stdresult:merged_env()
 end
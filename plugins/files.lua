@@ -41,9 +41,11 @@ local tools = require("tools")
 -- @param physpath Current location and filename to be unpacked later.
 -- @param virtpath Location and name of the file at the time of unpacking.
 -- @param destdir Path where the unpacked files shall be put.
+-- @param threaded Use the configured multithreaded zstd and xz tools.
+--                 Only valid if the command is run by e2factory itself.
 -- @return Tool name (string), or false on error.
 -- @return Argument vector table for the tool, or an error object on failure.
-local function gen_unpack_command(physpath, virtpath, destdir)
+local function gen_unpack_command(physpath, virtpath, destdir, threaded)
 
     --- Determine archive type by looking at the file extension.
     -- @param filename File name (string).
@@ -60,8 +62,10 @@ local function gen_unpack_command(physpath, virtpath, destdir)
             atype = "TAR_GZ"
         elseif name:match('%.tar%.bz2$') or name:match('%.tbz2$') then
             atype = "TAR_BZIP2"
-        elseif name:match("%.tar%.xz$") then
+        elseif name:match("%.tar%.xz$") or name:match("%.txz$") then
             atype = "TAR_XZ"
+        elseif name:match("%.tar%.zst$") or name:match("%.tzst$") then
+            atype = "TAR_ZSTD"
         elseif name:match("%.zip$") then
             atype = "ZIP"
         else
@@ -105,6 +109,17 @@ local function gen_unpack_command(physpath, virtpath, destdir)
         table.insert(toolargv, destdir)
         table.insert(toolargv, "-xf")
         table.insert(toolargv, virtpath)
+    elseif (atype == "TAR_XZ" or atype == "TAR_ZSTD") and threaded then
+        tool = "tar"
+        toolargv, re = e2lib.tar_compress_flags(
+            atype == "TAR_XZ" and "tar.xz" or "tar.zst")
+        if not toolargv then
+            return false, re
+        end
+        table.insert(toolargv, "-C")
+        table.insert(toolargv, destdir)
+        table.insert(toolargv, "-xf")
+        table.insert(toolargv, virtpath)
     elseif atype == "TAR_XZ" then
         tool = "tar"
         table.insert(toolargv, "--xz")
@@ -112,6 +127,13 @@ local function gen_unpack_command(physpath, virtpath, destdir)
         table.insert(toolargv, destdir)
         table.insert(toolargv, "-xf")
         table.insert(toolargv, virtpath)
+    elseif atype == "TAR_ZSTD" then
+        tool = "tar"
+        table.insert(toolargv, "--zstd")
+        table.insert(toolargv, "-C")
+        table.insert(toolargv, destdir)
+        table.insert(toolargv, "-xf")
+        table.insert(toolargv, virtpath)
     else
         return false, err.new("unhandled archive type")
     end
@@ -462,7 +484,7 @@ function files.files_source:prepare_source(sourceset, buildpath)
                 return false, e:cat(re)
             end
 
-            local rc, re = gen_unpack_command(path, path, buildpath)
+            local rc, re = gen_unpack_command(path, path, buildpath, true)
             if not rc then
                 return false, e:cat(re)
             end
@@ -21,6 +21,7 @@
 local git = {}
 local cache = require("cache")
 local class = require("class")
+local digest = require("digest")
 local e2lib = require("e2lib")
 local e2option = require("e2option")
 local e2tool = require("e2tool")
@@ -222,6 +223,90 @@ function git.git_source:_refs_prefered_local_remote_branch()
     return ref, id
 end
 
+--- Create the error of a failed working copy digest.
+-- @param src Source object.
+-- @param re Error object of the cause.
+-- @return Error object.
+local function wc_content_error(src, re)
+    return err.new("calculating working copy digest failed for source: %s",
+        src:get_name()):cat(re)
+end
+
+--- Return a digest of the working copy contents, as prepare_source() copies
+-- them in working-copy mode: the index and every file that differs from it,
+-- including untracked and ignored files. Unchanged files are not read, the
+-- checksums of changed files are cached by file status.
+-- @return True on success, false on error.
+-- @return Error object on failure.
+-- @return Working copy digest (string) on success.
+function git.git_source:_working_copy_content_id()
+    local rc, re, gitwc, argv, index, out, paths, abspaths, dt, hc, sbv
+
+    rc, re = self:working_copy_available()
+    if not rc then
+        return false, wc_content_error(self, re)
+    end
+
+    gitwc = e2lib.join(e2tool.root(), self:get_working())
+
+    -- mode, blob id and stage of every file in the index
+    argv = generic_git.git_new_argv(nil, gitwc, "ls-files", "--stage", "-z")
+    rc, re, index = generic_git.git(argv)
+    if rc then
+        -- modified, deleted, untracked and ignored files
+        argv = generic_git.git_new_argv(nil, gitwc, "ls-files", "--modified",
+            "--others", "-z")
+        rc, re, out = generic_git.git(argv)
+    end
+    if not rc then
+        return false, wc_content_error(self, re)
+    end
+
+    paths = {}
+    for path in string.gmatch(out, "[^%z]+") do
+        table.insert(paths, path)
+    end
+    table.sort(paths)
+
+    abspaths = {}
+    for i,path in ipairs(paths) do
+        abspaths[i] = e2lib.join(gitwc, path)
+    end
+
+    hc = hash.hash_start()
+    hash.hash_append(hc, index)
+
+    dt = digest.new()
+    sbv = e2lib.statv(abspaths, false)
+    for i,path in ipairs(paths) do
+        local sb = sbv[i]
+
+        hash.hash_append(hc, path)
+        if not sb then
+            hash.hash_append(hc, "deleted")
+        elseif sb.type == "symbolic-link" then
+            hash.hash_append(hc, e2lib.readlink(abspaths[i]) or "")
+        elseif sb.type == "regular" then
+            -- permissions are copied along with the file
+            hash.hash_append(hc, string.format("%o", sb.mode % 512))
+            digest.new_entry(dt, digest.SHA1, nil, path)
+        else
+            hash.hash_append(hc, sb.type)
+        end
+    end
+
+    rc, re = digest.checksum(dt, gitwc)
+    if not rc then
+        return false, wc_content_error(self, re)
+    end
+
+    for _,entry in ipairs(dt) do
+        hash.hash_append(hc, entry.checksum)
+    end
+
+    return true, nil, hash.hash_finish(hc)
+end
+
 --- Return the git commit ID of the specified source configuration. Specific to
 -- sources of type git, useful for writing plugins.
 -- @param sourceset string: the sourceset
@@ -291,15 +376,24 @@ function git.git_source:sourceid(sourceset)
     assert(type(sourceset) == "string" and #sourceset > 0,
         "sourceset arg invalid")
 
-    local rc, re, id, hc
+    local rc, re, id, hc, key
     local check_remote = policy.opts.check_remote()
     assertIsBoolean(check_remote)
 
-    if self._sourceids[sourceset] then
-        return self._sourceids[sourceset]
+    key = sourceset
+    if sourceset == "working-copy" and policy.opts.wc_content() then
+        key = "wc-content"
     end
 
-    rc, re, id = self:git_commit_id(sourceset, check_remote)
+    if self._sourceids[key] then
+        return self._sourceids[key]
+    end
+
+    if key == "wc-content" then
+        rc, re, id = self:_working_copy_content_id()
+    else
+        rc, re, id = self:git_commit_id(sourceset, check_remote)
+    end
     if not rc then
         return false, re
     end
@@ -320,13 +414,13 @@ function git.git_source:sourceid(sourceset)
     hash.hash_append(hc, self._server)
     hash.hash_append(hc, self._location)
     hash.hash_append(hc, id)
-    self._commitids[sourceset] = id
-    self._sourceids[sourceset] = hash.hash_finish(hc)
+    self._commitids[key] = id
+    self._sourceids[key] = hash.hash_finish(hc)
 
     e2lib.logf(4, "BUILDID: source=%s sourceset=%s sourceid=%s",
-        self._name, sourceset, self._sourceids[sourceset])
+        self._name, key, self._sourceids[key])
 
-    return self._sourceids[sourceset]
+    return self._sourceids[key]
 end
 
 function git.git_source:display()
@@ -500,12 +594,23 @@ function git.git_source:fetch_source()
         self:get_branch())
 
     local skip_checkout = not self._checkout
+    local shallow_branch = e2option.opts["shallow"] and self:get_branch()
     rc, re = generic_git.git_clone_from_server(cache.cache(), self:get_server(),
-        self:get_location(), work_tree, skip_checkout)
+        self:get_location(), work_tree, skip_checkout, shallow_branch)
     if not rc then
         return false, e:cat(re)
     end
 
+    if shallow_branch and e2lib.exists(e2lib.join(git_dir, "shallow")) then
+        -- the branch head may not contain the tag
+        rc, re = generic_git.git(generic_git.git_new_argv(git_dir, work_tree,
+            "fetch", "--quiet", "--depth", "1", "origin", "tag",
+            self:get_tag()))
+        if not rc then
+            return false, e:cat(re)
+        end
+    end
+
     if not self._checkout then
         return true
     end
@@ -561,6 +666,8 @@ function git.git_source:update_source()
         return true
     end
 
+    generic_git.git_update_mirror(gitdir)
+
     argv = generic_git.git_new_argv(gitdir, gitwc, "fetch", "--tags")
     rc, re = generic_git.git(argv)
     if not rc then
@@ -813,7 +920,9 @@ function git.git_source:prepare_source(sourceset, buildpath)
     local errors = false
     while (#children > 0) do
         local found = false
-        status, pid = e2lib.wait_pid_delete(-1)
+        -- wait for our children only, other children may be running
+        -- in the background (writeback queue)
+        status, pid = e2lib.wait_pid_delete(children[1].pid)
         if not status then
             return false, e:cat(pid)
         end
@@ -984,6 +1093,8 @@ local function git_plugin_init(ctx)
 
     if e2tool.current_tool() == "fetch-sources" then
         e2option.flag("git", "select git sources")
+        e2option.flag("shallow", "clone git sources with the head of their "..
+            "branch and their tag only")
     end
 
     return true
@@ -391,6 +391,8 @@ function gitrepo_source:update_source()
     gitwc  = e2lib.join(e2tool.root(), self:get_working())
     gitdir = e2lib.join(gitwc, ".git")
 
+    generic_git.git_update_mirror(gitdir)
+
     argv = generic_git.git_new_argv(gitdir, gitwc, "fetch")
     rc, re = generic_git.git(argv)
     if not rc then